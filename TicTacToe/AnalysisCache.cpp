@@ -0,0 +1,288 @@
+#include "AnalysisCache.h"
+#include <cassert>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char cCacheFileMagic[4] = { 'T', 'T', 'T', 'C' };
+static const uint32_t cCacheFileVersion = 1;
+
+AnalysisCache::AnalysisCache()
+{
+}
+
+AnalysisCache::~AnalysisCache()
+{
+	Close();
+}
+
+bool AnalysisCache::Open(const char* fileName, int numEntries)
+{
+	assert(fileName != NULL);
+	assert(numEntries > 0);
+
+	Close();
+	if (!OpenFile(fileName)) return false;
+
+	// Only one process gets to look at (and maybe set up) the file at a time. Otherwise a process that came along just
+	// after another one created the file could see it half written, or zero it again after entries had gone in
+	if (!LockFileForSetup())
+	{
+		Close();
+		return false;
+	}
+
+	// An empty file is one we have just created (or one that was left empty), so it is ours to set up. Anything else
+	// has to already be a cache, so that pointing this at the wrong file can never wipe it
+	int64_t fileSize = GetFileSize();
+	bool opened;
+	if (fileSize == 0) opened = InitialiseFile(numEntries);
+	else opened = MapExistingFile(fileSize);
+
+	UnlockFileAfterSetup();
+	if (!opened) Close();
+	return opened;
+}
+
+bool AnalysisCache::MapExistingFile(int64_t fileSize)
+{
+	// Check the header with a plain read first, so that we never map some big file that isn't ours
+	Header header;
+	if (fileSize < (int64_t)sizeof(Header) || !ReadHeader(&header)) return false;
+
+	bool valid = memcmp(header.magic, cCacheFileMagic, sizeof(cCacheFileMagic)) == 0;
+	valid = valid && header.version == cCacheFileVersion;
+	valid = valid && header.numEntries != 0 && (header.numEntries & (header.numEntries - 1)) == 0;
+	valid = valid && fileSize == (int64_t)(sizeof(Header) + (uint64_t)header.numEntries * sizeof(Entry));
+	if (!valid || !MapFile((size_t)fileSize)) return false;
+
+	pEntries = (Entry*)(pHeader + 1);
+	iEntryMask = pHeader->numEntries - 1;
+	return true;
+}
+
+bool AnalysisCache::InitialiseFile(int numEntries)
+{
+	uint32_t entries = 1;
+	while (entries * 2 <= (uint32_t)numEntries) entries *= 2;
+
+	size_t size = sizeof(Header) + entries * sizeof(Entry);
+	if (!SetFileSize((int64_t)size) || !MapFile(size))
+	{
+		// Leave it empty rather than the wrong size, so that the next attempt can have another go at setting it up
+		SetFileSize(0);
+		return false;
+	}
+
+	pEntries = (Entry*)(pHeader + 1);
+	memset((void*)pEntries, 0, entries * sizeof(Entry));
+	pHeader->version = cCacheFileVersion;
+	pHeader->numEntries = entries;
+	pHeader->reserved = 0;
+	// The magic goes in last, so a header without it is never trusted even if we die part way through
+	memcpy(pHeader->magic, cCacheFileMagic, sizeof(cCacheFileMagic));
+	iEntryMask = entries - 1;
+	return true;
+}
+
+bool AnalysisCache::IsOpen() const
+{
+	return pEntries != NULL;
+}
+
+bool AnalysisCache::Lookup(uint64_t key, int* location) const
+{
+	assert(location != NULL);
+
+	if (pEntries == NULL) return false;
+
+	// The keys are Zobrist hashes, so the low bits are as good as any for picking the entry
+	const Entry& entry = pEntries[key & iEntryMask];
+	uint64_t data = entry.data;
+	uint64_t keyXorData = entry.keyXorData;
+	if (data == 0 || (keyXorData ^ data) != key) return false;
+
+	// The location is stored off by one so that a valid entry is never all zeros
+	*location = (int)(data & 0xFFFFFFFF) - 1;
+	return true;
+}
+
+void AnalysisCache::Store(uint64_t key, int location)
+{
+	assert(location >= 0);
+
+	if (pEntries == NULL) return;
+
+	Entry& entry = pEntries[key & iEntryMask];
+	uint64_t data = (uint64_t)(uint32_t)(location + 1);
+	entry.keyXorData = key ^ data;
+	entry.data = data;
+}
+
+#ifdef _WIN32
+
+bool AnalysisCache::OpenFile(const char* fileName)
+{
+	HANDLE file = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+		OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	hFile = file;
+	return true;
+}
+
+int64_t AnalysisCache::GetFileSize() const
+{
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx((HANDLE)hFile, &size)) return -1;
+	return size.QuadPart;
+}
+
+bool AnalysisCache::ReadHeader(Header* header) const
+{
+	OVERLAPPED overlapped;
+	memset(&overlapped, 0, sizeof(overlapped));
+	DWORD bytesRead = 0;
+	if (!ReadFile((HANDLE)hFile, header, sizeof(Header), &bytesRead, &overlapped)) return false;
+	return bytesRead == sizeof(Header);
+}
+
+bool AnalysisCache::SetFileSize(int64_t size)
+{
+	LARGE_INTEGER position;
+	position.QuadPart = size;
+	if (!SetFilePointerEx((HANDLE)hFile, position, NULL, FILE_BEGIN)) return false;
+	return SetEndOfFile((HANDLE)hFile) != 0;
+}
+
+// The lock is on a byte far past the end of any real cache file, so it never gets in the way of the mapped entries
+static void SetUpLockRange(OVERLAPPED* overlapped)
+{
+	memset(overlapped, 0, sizeof(*overlapped));
+	overlapped->OffsetHigh = 0x40000000;
+}
+
+bool AnalysisCache::LockFileForSetup()
+{
+	OVERLAPPED overlapped;
+	SetUpLockRange(&overlapped);
+	return LockFileEx((HANDLE)hFile, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped) != 0;
+}
+
+void AnalysisCache::UnlockFileAfterSetup()
+{
+	OVERLAPPED overlapped;
+	SetUpLockRange(&overlapped);
+	UnlockFileEx((HANDLE)hFile, 0, 1, 0, &overlapped);
+}
+
+bool AnalysisCache::MapFile(size_t size)
+{
+	HANDLE mapping = CreateFileMappingA((HANDLE)hFile, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32),
+		(DWORD)(size & 0xFFFFFFFF), NULL);
+	if (mapping == NULL) return false;
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (view == NULL)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+
+	hMapping = mapping;
+	pHeader = (Header*)view;
+	iMappedSize = size;
+	return true;
+}
+
+void AnalysisCache::UnmapFile()
+{
+	if (pHeader != NULL) UnmapViewOfFile(pHeader);
+	if (hMapping != NULL) CloseHandle((HANDLE)hMapping);
+	pHeader = NULL;
+	pEntries = NULL;
+	hMapping = NULL;
+	iMappedSize = 0;
+}
+
+void AnalysisCache::Close()
+{
+	UnmapFile();
+	if (hFile != NULL) CloseHandle((HANDLE)hFile);
+	hFile = NULL;
+}
+
+#else
+
+bool AnalysisCache::OpenFile(const char* fileName)
+{
+	int fd = open(fileName, O_RDWR | O_CREAT, 0666);
+	if (fd == -1) return false;
+
+	iFileDescriptor = fd;
+	return true;
+}
+
+int64_t AnalysisCache::GetFileSize() const
+{
+	struct stat status;
+	if (fstat(iFileDescriptor, &status) != 0) return -1;
+	return (int64_t)status.st_size;
+}
+
+bool AnalysisCache::ReadHeader(Header* header) const
+{
+	return pread(iFileDescriptor, header, sizeof(Header), 0) == (ssize_t)sizeof(Header);
+}
+
+bool AnalysisCache::SetFileSize(int64_t size)
+{
+	return ftruncate(iFileDescriptor, (off_t)size) == 0;
+}
+
+bool AnalysisCache::LockFileForSetup()
+{
+	return flock(iFileDescriptor, LOCK_EX) == 0;
+}
+
+void AnalysisCache::UnlockFileAfterSetup()
+{
+	flock(iFileDescriptor, LOCK_UN);
+}
+
+bool AnalysisCache::MapFile(size_t size)
+{
+	void* view = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, iFileDescriptor, 0);
+	if (view == MAP_FAILED) return false;
+
+	pHeader = (Header*)view;
+	iMappedSize = size;
+	return true;
+}
+
+void AnalysisCache::UnmapFile()
+{
+	if (pHeader != NULL) munmap(pHeader, iMappedSize);
+	pHeader = NULL;
+	pEntries = NULL;
+	iMappedSize = 0;
+}
+
+void AnalysisCache::Close()
+{
+	UnmapFile();
+	if (iFileDescriptor != -1) close(iFileDescriptor);
+	iFileDescriptor = -1;
+}
+
+#endif
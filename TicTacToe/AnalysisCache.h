@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// A transposition/analysis cache that lives in a memory mapped file, so that every game process on the machine can
+// share it and it is still warm after a restart. It maps a 64 bit position key to the move the computer settled on.
+//
+// There are no locks. Each entry is two 64 bit words, the key XORed with the data and the data itself. A reader only
+// accepts an entry if the two words agree with the key it is looking for, so an entry torn by two processes writing it
+// at once just reads as a miss. The worst a collision or a race can do is cost us a recalculation.
+
+class AnalysisCache
+{
+public:
+
+	AnalysisCache();
+	~AnalysisCache();
+
+	// Maps the cache file, creating it if needed. An existing cache file is used as is, whatever its size, so that every
+	// process agrees on the layout. numEntries is rounded down to a power of two and only matters for a new (empty) file.
+	// Returns false if the file can't be mapped, or if it has something in it that isn't a cache, which is left alone
+	bool Open(const char* fileName, int numEntries);
+	void Close();
+	bool IsOpen() const;
+
+	// Returns true and fills in the location if there is an entry for this key
+	bool Lookup(uint64_t key, int* location) const;
+	void Store(uint64_t key, int location);
+
+private:
+
+	// Revoke copy construction and assignment
+	AnalysisCache(const AnalysisCache&);
+	AnalysisCache& operator=(const AnalysisCache& rhs);
+
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t numEntries;
+		uint32_t reserved;
+	};
+
+	struct Entry
+	{
+		volatile uint64_t keyXorData;
+		// Zero means the entry has never been written
+		volatile uint64_t data;
+	};
+
+	bool MapExistingFile(int64_t fileSize);
+	bool InitialiseFile(int numEntries);
+
+	// The platform specific parts
+	bool OpenFile(const char* fileName);
+	// Held while Open looks at the file, so that only one process ever sets it up
+	bool LockFileForSetup();
+	void UnlockFileAfterSetup();
+	int64_t GetFileSize() const;
+	bool ReadHeader(Header* header) const;
+	bool SetFileSize(int64_t size);
+	bool MapFile(size_t size);
+	void UnmapFile();
+
+	Header* pHeader = NULL;
+	Entry* pEntries = NULL;
+	uint64_t iEntryMask = 0;
+	size_t iMappedSize = 0;
+
+	// Only one of these is used, depending on the platform. The Windows ones are really HANDLEs
+	void* hFile = NULL;
+	void* hMapping = NULL;
+	int iFileDescriptor = -1;
+};
@@ -0,0 +1,330 @@
+#include "Arena.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// The z value for a 95% confidence interval
+static const double cConfidenceZ = 1.96;
+
+// CPU time used by the calling thread, so that games running on other cores don't get counted against this one.
+// Note that Windows only updates this once per scheduler tick, so very fast moves will mostly read as zero there
+static double ThreadCpuMilliseconds()
+{
+#ifdef _WIN32
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime)) return 0.0;
+	uint64_t kernel = ((uint64_t)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime;
+	uint64_t user = ((uint64_t)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime;
+	// FILETIMEs count in 100ns units
+	return (kernel + user) / 10000.0;
+#else
+	timespec now;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) return 0.0;
+	return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+#endif
+}
+
+// Elo difference implied by an expected score. A perfect (or perfectly awful) score has no finite Elo
+static std::string FormatElo(double score)
+{
+	if (score <= 0.0) return "-inf";
+	if (score >= 1.0) return "+inf";
+
+	// Round to the nearest point first so that an even score doesn't come out as "-0"
+	double elo = std::floor(-400.0 * std::log10(1.0 / score - 1.0) + 0.5);
+	char text[32];
+	snprintf(text, sizeof(text), "%+.0f", elo == 0.0 ? 0.0 : elo);
+	return text;
+}
+
+// Score (wins plus half the draws, as a fraction of the games) and the half width of its 95% confidence interval
+static void CalculateScore(int wins, int draws, int losses, double* score, double* interval)
+{
+	int numGames = wins + draws + losses;
+	if (numGames == 0)
+	{
+		*score = 0.5;
+		*interval = 0.5;
+		return;
+	}
+
+	*score = (wins + 0.5 * draws) / numGames;
+	double variance = wins * (1.0 - *score) * (1.0 - *score) + draws * (0.5 - *score) * (0.5 - *score) +
+		losses * *score * *score;
+	variance /= numGames;
+	*interval = cConfidenceZ * std::sqrt(variance / numGames);
+}
+
+Arena::Arena(int width, int height, const PatternEvaluator* evaluator)
+{
+	iBoardWidth = width;
+	iBoardHeight = height;
+	pEvaluator = evaluator;
+}
+
+bool Arena::AddEngine(const std::string& spec)
+{
+	Engine engine;
+	if (!ParseEngineSpec(spec, &engine.settings)) return false;
+
+	engine.name = spec;
+	vEngines.push_back(engine);
+	return true;
+}
+
+int Arena::GetNumEngines() const
+{
+	return (int)vEngines.size();
+}
+
+bool Arena::ParseEngineSpec(const std::string& spec, EngineSettings* settings)
+{
+	assert(settings != NULL);
+
+	// Everything is off unless the spec asks for it, so "heuristic" on its own is just the fixed rules
+	settings->bUsePatterns = false;
+	settings->iSearchDepth = 0;
+	settings->iTimeBudgetMs = 0;
+
+	size_t start = 0;
+	while (start <= spec.size())
+	{
+		size_t end = spec.find('+', start);
+		if (end == std::string::npos) end = spec.size();
+		std::string part = spec.substr(start, end - start);
+		start = end + 1;
+
+		int value;
+		if (part == "heuristic") continue;
+		else if (part == "patterns") settings->bUsePatterns = true;
+		else if (sscanf_s(part.c_str(), "depth=%d", &value) == 1 && value > 0) settings->iSearchDepth = value;
+		else if (sscanf_s(part.c_str(), "time=%d", &value) == 1 && value > 0) settings->iTimeBudgetMs = value;
+		else return false;
+	}
+	return true;
+}
+
+void Arena::Run(int numOpenings, int openingPlies, unsigned int seed, int numThreads)
+{
+	assert(numOpenings > 0);
+	assert(numThreads > 0);
+
+	// Round robin, and each pair plays every opening twice, swapping who goes first
+	vGames.clear();
+	for (int first = 0; first < (int)vEngines.size(); first++)
+	{
+		for (int second = first + 1; second < (int)vEngines.size(); second++)
+		{
+			for (int opening = 0; opening < numOpenings; opening++)
+			{
+				Game game;
+				game.opening = opening;
+				game.result = 0;
+				game.firstEngine = first;
+				game.secondEngine = second;
+				vGames.push_back(game);
+				game.firstEngine = second;
+				game.secondEngine = first;
+				vGames.push_back(game);
+			}
+		}
+	}
+
+	std::cout << "Playing " << vGames.size() << " games on " << numThreads << " threads...\n";
+
+	// Each thread has a board of its own and takes the next game off the list until they are all done. Every game
+	// writes only to its own entry, so the only thing the threads share is the counter
+	std::atomic<int> nextGame(0);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < numThreads; i++)
+	{
+		threads.push_back(std::thread([this, &nextGame, openingPlies, seed]()
+		{
+			TicTacToeBoard board(iBoardWidth, iBoardHeight);
+			board.SetEvaluator(pEvaluator);
+			for (int game = nextGame++; game < (int)vGames.size(); game = nextGame++)
+			{
+				PlayGame(&board, &vGames[game], openingPlies, seed);
+			}
+		}));
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+}
+
+void Arena::PlayGame(TicTacToeBoard* board, Game* game, int openingPlies, unsigned int seed) const
+{
+	board->ResetBoard();
+
+	// The opening only depends on the seed and the opening number, so every pairing gets exactly the same ones.
+	// The engines carry on drawing from the same generator for their own random moves, so the whole game is repeatable
+	board->SetRandomSeed(seed + game->opening);
+
+	char mover = TicTacToeBoard::cPlayerPiece;
+	char waiting = TicTacToeBoard::cComputerPiece;
+	for (int ply = 0; ; ply++)
+	{
+		if (board->DidSomeoneWin(TicTacToeBoard::cPlayerPiece))
+		{
+			game->result = 1;
+			return;
+		}
+		if (board->DidSomeoneWin(TicTacToeBoard::cComputerPiece))
+		{
+			game->result = -1;
+			return;
+		}
+		if (board->IsGameADraw())
+		{
+			game->result = 0;
+			return;
+		}
+
+		int location;
+		if (ply < openingPlies)
+		{
+			location = board->PickRandomMove();
+		}
+		else
+		{
+			bool firstToMove = mover == TicTacToeBoard::cPlayerPiece;
+			const Engine& engine = vEngines[firstToMove ? game->firstEngine : game->secondEngine];
+			board->SetEngineSettings(engine.settings);
+
+			double startTime = ThreadCpuMilliseconds();
+			location = board->CalculateBestMove(mover);
+			double moveTime = ThreadCpuMilliseconds() - startTime;
+
+			if (firstToMove) game->firstEngineMoveTimes.push_back(moveTime);
+			else game->secondEngineMoveTimes.push_back(moveTime);
+		}
+		board->MakeMove(location, mover);
+
+		char swap = mover;
+		mover = waiting;
+		waiting = swap;
+	}
+}
+
+double Arena::GetScore(int engine, double* interval) const
+{
+	assert(engine >= 0 && engine < (int)vEngines.size());
+	assert(interval != NULL);
+
+	int wins = 0, draws = 0, losses = 0;
+	for (size_t i = 0; i < vGames.size(); i++)
+	{
+		const Game& game = vGames[i];
+		if (game.firstEngine != engine && game.secondEngine != engine) continue;
+
+		// Turn the result round when this engine was the one moving second
+		int result = game.firstEngine == engine ? game.result : -game.result;
+		if (result > 0) wins++;
+		else if (result < 0) losses++;
+		else draws++;
+	}
+
+	double score;
+	CalculateScore(wins, draws, losses, &score, interval);
+	return score;
+}
+
+void Arena::PrintReport() const
+{
+	int numEngines = (int)vEngines.size();
+
+	// Tally up wins/draws/losses per pairing (from the point of view of the row engine) and per engine
+	std::vector<int> wins(numEngines * numEngines, 0), draws(numEngines * numEngines, 0), losses(numEngines * numEngines, 0);
+	std::vector<std::vector<double> > moveTimes(numEngines);
+	for (size_t i = 0; i < vGames.size(); i++)
+	{
+		const Game& game = vGames[i];
+		int forward = game.firstEngine * numEngines + game.secondEngine;
+		int backward = game.secondEngine * numEngines + game.firstEngine;
+		if (game.result > 0)
+		{
+			wins[forward]++;
+			losses[backward]++;
+		}
+		else if (game.result < 0)
+		{
+			losses[forward]++;
+			wins[backward]++;
+		}
+		else
+		{
+			draws[forward]++;
+			draws[backward]++;
+		}
+		moveTimes[game.firstEngine].insert(moveTimes[game.firstEngine].end(), game.firstEngineMoveTimes.begin(), game.firstEngineMoveTimes.end());
+		moveTimes[game.secondEngine].insert(moveTimes[game.secondEngine].end(), game.secondEngineMoveTimes.begin(), game.secondEngineMoveTimes.end());
+	}
+
+	char line[256];
+	std::cout << "\nResults on a " << iBoardWidth << "x" << iBoardHeight << " board (score and Elo against the rest of the field, 95% confidence):\n";
+	snprintf(line, sizeof(line), "%-24s %6s %16s %20s %12s %12s\n", "engine", "games", "score", "Elo", "mean ms/move", "p99 ms/move");
+	std::cout << line;
+
+	for (int engine = 0; engine < numEngines; engine++)
+	{
+		int totalWins = 0, totalDraws = 0, totalLosses = 0;
+		for (int opponent = 0; opponent < numEngines; opponent++)
+		{
+			totalWins += wins[engine * numEngines + opponent];
+			totalDraws += draws[engine * numEngines + opponent];
+			totalLosses += losses[engine * numEngines + opponent];
+		}
+		double score, interval;
+		CalculateScore(totalWins, totalDraws, totalLosses, &score, &interval);
+
+		std::vector<double> times = moveTimes[engine];
+		double meanTime = 0.0, p99Time = 0.0;
+		if (!times.empty())
+		{
+			std::sort(times.begin(), times.end());
+			for (size_t i = 0; i < times.size(); i++) meanTime += times[i];
+			meanTime /= times.size();
+			size_t p99Index = (size_t)std::ceil(0.99 * times.size()) - 1;
+			p99Time = times[p99Index];
+		}
+
+		char scoreText[32], eloText[64];
+		snprintf(scoreText, sizeof(scoreText), "%5.1f%% +/- %4.1f%%", 100.0 * score, 100.0 * interval);
+		snprintf(eloText, sizeof(eloText), "%s [%s, %s]", FormatElo(score).c_str(), FormatElo(score - interval).c_str(),
+			FormatElo(score + interval).c_str());
+		snprintf(line, sizeof(line), "%-24s %6d %16s %20s %12.3f %12.3f\n", vEngines[engine].name.c_str(),
+			totalWins + totalDraws + totalLosses, scoreText, eloText, meanTime, p99Time);
+		std::cout << line;
+	}
+
+	std::cout << "\nHead to head (wins/draws/losses for the first engine):\n";
+	for (int first = 0; first < numEngines; first++)
+	{
+		for (int second = first + 1; second < numEngines; second++)
+		{
+			int pairing = first * numEngines + second;
+			double score, interval;
+			CalculateScore(wins[pairing], draws[pairing], losses[pairing], &score, &interval);
+
+			snprintf(line, sizeof(line), "%s vs %s: +%d =%d -%d, score %.1f%% +/- %.1f%%, Elo %s [%s, %s]\n",
+				vEngines[first].name.c_str(), vEngines[second].name.c_str(), wins[pairing], draws[pairing], losses[pairing],
+				100.0 * score, 100.0 * interval, FormatElo(score).c_str(), FormatElo(score - interval).c_str(),
+				FormatElo(score + interval).c_str());
+			std::cout << line;
+		}
+	}
+}
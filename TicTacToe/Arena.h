@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "TicTacToeBoard.h"
+#include "PatternEvaluator.h"
+
+// A tournament harness for weighing up computer player settings against each other. Every pair of engines plays the
+// same set of random openings, once with each engine moving first, so that neither gets a luckier start. The games are
+// spread across all the cores, and every game is seeded so that a run can be repeated.
+//
+// The report gives each engine's score with a 95% confidence interval and Elo, along with the CPU time it spent per
+// move (mean and 99th percentile), so that strength can be traded off against cost.
+
+class Arena
+{
+public:
+
+	// The evaluator is shared by all of the games and is not owned by the arena
+	Arena(int width, int height, const PatternEvaluator* evaluator);
+
+	// An engine spec is a '+' separated list of: heuristic, patterns, depth=N, time=MS. For example "patterns+depth=2"
+	// Returns false if the spec doesn't parse
+	bool AddEngine(const std::string& spec);
+	int GetNumEngines() const;
+	// Turns an engine spec into the settings for it, so that the winner of a tournament can be used in a real game
+	static bool ParseEngineSpec(const std::string& spec, EngineSettings* settings);
+
+	// Plays every pair of engines against each other from numOpenings openings of openingPlies random moves each
+	void Run(int numOpenings, int openingPlies, unsigned int seed, int numThreads);
+	void PrintReport() const;
+	// An engine's score against the rest of the field, from the last Run, and the half width of its 95% confidence interval
+	double GetScore(int engine, double* interval) const;
+
+private:
+
+	struct Engine
+	{
+		std::string name;
+		EngineSettings settings;
+	};
+
+	// One game to be played. The first engine plays cPlayerPiece and moves first
+	struct Game
+	{
+		int firstEngine, secondEngine;
+		int opening;
+		// 1 if the first engine won, -1 if the second engine won, 0 for a draw
+		int result;
+		// CPU milliseconds for each move each engine made, not counting the opening
+		std::vector<double> firstEngineMoveTimes, secondEngineMoveTimes;
+	};
+
+	void PlayGame(TicTacToeBoard* board, Game* game, int openingPlies, unsigned int seed) const;
+
+	int iBoardWidth, iBoardHeight;
+	const PatternEvaluator* pEvaluator;
+	std::vector<Engine> vEngines;
+	std::vector<Game> vGames;
+};
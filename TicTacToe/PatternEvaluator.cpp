@@ -0,0 +1,250 @@
+#include "PatternEvaluator.h"
+#include <cassert>
+#include <cmath>
+#include <fstream>
+
+// The weights file is a small header followed by the raw little endian floats, which is all we ever run on. Version 2
+// added the board size to the header and made the diagonal segments wrap, so version 1 weights are no use any more
+static const char cWeightsFileMagic[4] = { 'N', 'T', 'P', 'W' };
+static const uint32_t cWeightsFileVersion = 2;
+
+// The four directions a segment can run in
+static const int cSegmentDirections[4][2] = { {1, 0}, {0, 1}, {1, 1}, {1, -1} };
+
+// How each square of a segment is encoded in the pattern index
+static const int cEmptySquare = 0;
+static const int cOwnSquare = 1;
+static const int cTheirSquare = 2;
+static const int cOffBoardSquare = 3;
+
+// The pattern of a segment lying entirely off the board. We never look these up
+static const int cAllOffBoardPattern = 255;
+
+PatternEvaluator::PatternEvaluator()
+{
+	for (int i = 0; i < cNumPatterns; i++)
+	{
+		fWeights[i] = 0.0f;
+	}
+	bHasWeights = false;
+	iBoardWidth = 0;
+	iBoardHeight = 0;
+}
+
+bool PatternEvaluator::LoadFromFile(const char* fileName)
+{
+	assert(fileName != NULL);
+
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file) return false;
+
+	char magic[4];
+	uint32_t version, tupleLength, numPatterns, boardWidth, boardHeight;
+	file.read(magic, sizeof(magic));
+	file.read((char*)&version, sizeof(version));
+	file.read((char*)&tupleLength, sizeof(tupleLength));
+	file.read((char*)&numPatterns, sizeof(numPatterns));
+	file.read((char*)&boardWidth, sizeof(boardWidth));
+	file.read((char*)&boardHeight, sizeof(boardHeight));
+	if (!file) return false;
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (magic[i] != cWeightsFileMagic[i]) return false;
+	}
+	if (version != cWeightsFileVersion || tupleLength != cTupleLength || numPatterns != cNumPatterns) return false;
+	if (boardWidth < 3 || boardHeight < 3) return false;
+
+	float weights[cNumPatterns];
+	file.read((char*)weights, sizeof(weights));
+	if (!file) return false;
+
+	for (int i = 0; i < cNumPatterns; i++)
+	{
+		fWeights[i] = weights[i];
+	}
+	bHasWeights = true;
+	iBoardWidth = (int)boardWidth;
+	iBoardHeight = (int)boardHeight;
+	return true;
+}
+
+bool PatternEvaluator::SaveToFile(const char* fileName) const
+{
+	assert(fileName != NULL);
+
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	if (!file) return false;
+
+	uint32_t version = cWeightsFileVersion;
+	uint32_t tupleLength = cTupleLength;
+	uint32_t numPatterns = cNumPatterns;
+	uint32_t boardWidth = iBoardWidth;
+	uint32_t boardHeight = iBoardHeight;
+	file.write(cWeightsFileMagic, sizeof(cWeightsFileMagic));
+	file.write((const char*)&version, sizeof(version));
+	file.write((const char*)&tupleLength, sizeof(tupleLength));
+	file.write((const char*)&numPatterns, sizeof(numPatterns));
+	file.write((const char*)&boardWidth, sizeof(boardWidth));
+	file.write((const char*)&boardHeight, sizeof(boardHeight));
+	file.write((const char*)fWeights, sizeof(fWeights));
+	return (bool)file;
+}
+
+bool PatternEvaluator::HasWeights() const
+{
+	return bHasWeights;
+}
+
+bool PatternEvaluator::IsTrainedFor(int width, int height) const
+{
+	return bHasWeights && width == iBoardWidth && height == iBoardHeight;
+}
+
+int PatternEvaluator::GetBoardWidth() const
+{
+	return iBoardWidth;
+}
+
+int PatternEvaluator::GetBoardHeight() const
+{
+	return iBoardHeight;
+}
+
+uint64_t PatternEvaluator::GetWeightsChecksum() const
+{
+	// FNV-1a over the raw bytes of the weights
+	const unsigned char* bytes = (const unsigned char*)fWeights;
+	uint64_t checksum = 0xCBF29CE484222325ull;
+	for (size_t i = 0; i < sizeof(fWeights); i++)
+	{
+		checksum ^= bytes[i];
+		checksum *= 0x100000001B3ull;
+	}
+	return checksum;
+}
+
+float PatternEvaluator::EvaluatePosition(const char* board, int width, int height, const char piece) const
+{
+	assert(board != NULL);
+
+	// Every segment that touches the board at all, which means starting up to cTupleLength-1 squares off the edge.
+	// The diagonals wrap around the sides, so they only ever start in one of the columns
+	float total = 0.0f;
+	for (int d = 0; d < 4; d++)
+	{
+		int dx = cSegmentDirections[d][0];
+		int dy = cSegmentDirections[d][1];
+		int overhangX = IsWrappingDirection(dx, dy) ? 0 : (cTupleLength - 1) * dx;
+		int overhangY = (cTupleLength - 1) * dy;
+
+		for (int y = (overhangY > 0 ? -overhangY : 0); y < height + (overhangY < 0 ? -overhangY : 0); y++)
+		{
+			for (int x = -overhangX; x < width; x++)
+			{
+				int index = PatternIndex(board, width, height, x, y, dx, dy, piece);
+				if (index != cAllOffBoardPattern) total += fWeights[index];
+			}
+		}
+	}
+	return total;
+}
+
+float PatternEvaluator::EvaluateMove(const char* board, int width, int height, int location, const char piece) const
+{
+	assert(board != NULL);
+	assert(location >= 0 && location < width * height);
+	assert(board[location] == ' ');
+
+	int x = location % width;
+	int y = location / width;
+
+	// The square is empty now, so filling it in just bumps its digit of the pattern index from empty to ours
+	float delta = 0.0f;
+	for (int d = 0; d < 4; d++)
+	{
+		int dx = cSegmentDirections[d][0];
+		int dy = cSegmentDirections[d][1];
+		int digit = 1;
+		for (int k = 0; k < cTupleLength; k++)
+		{
+			int before = PatternIndex(board, width, height, x - k * dx, y - k * dy, dx, dy, piece);
+			int after = before + (cOwnSquare - cEmptySquare) * digit;
+			delta += fWeights[after] - fWeights[before];
+			digit *= 4;
+		}
+	}
+	return delta;
+}
+
+float PatternEvaluator::EstimateWinChance(const char* board, int width, int height, const char piece) const
+{
+	return 1.0f / (1.0f + std::exp(-EvaluatePosition(board, width, height, piece)));
+}
+
+void PatternEvaluator::Train(const char* board, int width, int height, const char piece, float target, float learningRate)
+{
+	assert(board != NULL);
+
+	if (!bHasWeights)
+	{
+		iBoardWidth = width;
+		iBoardHeight = height;
+	}
+	assert(width == iBoardWidth && height == iBoardHeight);
+
+	// Gradient of the squared error through the sigmoid. Every segment's weight gets the same nudge, once per segment
+	float estimate = EstimateWinChance(board, width, height, piece);
+	float step = learningRate * (target - estimate) * estimate * (1.0f - estimate);
+
+	for (int d = 0; d < 4; d++)
+	{
+		int dx = cSegmentDirections[d][0];
+		int dy = cSegmentDirections[d][1];
+		int overhangX = IsWrappingDirection(dx, dy) ? 0 : (cTupleLength - 1) * dx;
+		int overhangY = (cTupleLength - 1) * dy;
+
+		for (int y = (overhangY > 0 ? -overhangY : 0); y < height + (overhangY < 0 ? -overhangY : 0); y++)
+		{
+			for (int x = -overhangX; x < width; x++)
+			{
+				int index = PatternIndex(board, width, height, x, y, dx, dy, piece);
+				if (index != cAllOffBoardPattern) fWeights[index] += step;
+			}
+		}
+	}
+	bHasWeights = true;
+}
+
+bool PatternEvaluator::IsWrappingDirection(int dx, int dy)
+{
+	return dx != 0 && dy != 0;
+}
+
+int PatternEvaluator::PatternIndex(const char* board, int width, int height, int x, int y, int dx, int dy, const char piece) const
+{
+	// The first square of the segment is the lowest base 4 digit
+	int index = 0;
+	int digit = 1;
+	for (int k = 0; k < cTupleLength; k++)
+	{
+		int squareX = x + k * dx;
+		int squareY = y + k * dy;
+		if (IsWrappingDirection(dx, dy)) squareX = ((squareX % width) + width) % width;
+		int state;
+		if (squareX < 0 || squareY < 0 || squareX >= width || squareY >= height)
+		{
+			state = cOffBoardSquare;
+		}
+		else
+		{
+			char square = board[squareY * width + squareX];
+			if (square == ' ') state = cEmptySquare;
+			else if (square == piece) state = cOwnSquare;
+			else state = cTheirSquare;
+		}
+		index += state * digit;
+		digit *= 4;
+	}
+	return index;
+}
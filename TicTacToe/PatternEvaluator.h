@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+
+// A table driven evaluation function (an n-tuple network) for the dense board. Every straight segment of cTupleLength
+// squares, in all four directions and allowed to hang off the edges of the board, is read as a pattern with each square
+// being empty, ours, theirs or off the board. Each pattern has a learned weight and the evaluation of a position is just
+// the sum of the weights of all its segments. The whole table is cNumPatterns floats, so every lookup hits L1 cache.
+//
+// The diagonal segments wrap around the sides of the board, the same way the diagonal wins do (see
+// TicTacToeBoard::HasDiagonalBeenWon). Rows and columns don't wrap, so their segments hang off the edges instead.
+//
+// The weights are trained offline by self-play (see TicTacToeBoard::TrainEvaluatorBySelfPlay) and saved to a small
+// binary file that the game loads at startup. Which lines win depends on the size of the board, so the weights are only
+// good for the size they were trained on, and the file says what that was.
+
+class PatternEvaluator
+{
+public:
+
+	static const int cTupleLength = 4;
+	// Four states per square, so 4^cTupleLength patterns
+	static const int cNumPatterns = 256;
+
+	PatternEvaluator();
+
+	// Returns false (and leaves the current weights alone) if the file is missing or not a weights file
+	bool LoadFromFile(const char* fileName);
+	bool SaveToFile(const char* fileName) const;
+	// True once weights have been loaded or trained. Until then the evaluator knows nothing and should not be used
+	bool HasWeights() const;
+	// True if there are weights and they were trained on a board of this size
+	bool IsTrainedFor(int width, int height) const;
+	// The size of the board the weights were trained on, or 0 if there are no weights yet
+	int GetBoardWidth() const;
+	int GetBoardHeight() const;
+	// A fingerprint of the weights, so that cached analysis from one set of weights is never used with another
+	uint64_t GetWeightsChecksum() const;
+
+	// The sum of the weights of every segment on the board, from the point of view of piece. Any other non empty
+	// square is treated as belonging to the opponent
+	float EvaluatePosition(const char* board, int width, int height, const char piece) const;
+	// How much placing piece on the empty square at location would change EvaluatePosition. Only the segments through
+	// that square are looked at, so this is cheap enough to call for every candidate move
+	float EvaluateMove(const char* board, int width, int height, int location, const char piece) const;
+	// EvaluatePosition squashed into an estimate (0..1) of how likely piece is to win from here
+	float EstimateWinChance(const char* board, int width, int height, const char piece) const;
+
+	// One temporal difference step: nudges the weights so that EstimateWinChance for this position moves towards target.
+	// The first step fixes the board size the weights are for, and every later one has to be on a board of that size
+	void Train(const char* board, int width, int height, const char piece, float target, float learningRate);
+
+private:
+
+	// The diagonals wrap around the sides of the board, the rows and columns don't
+	static bool IsWrappingDirection(int dx, int dy);
+	int PatternIndex(const char* board, int width, int height, int x, int y, int dx, int dy, const char piece) const;
+
+	float fWeights[cNumPatterns];
+	bool bHasWeights;
+	int iBoardWidth, iBoardHeight;
+};
@@ -0,0 +1,342 @@
+#include "SparseBoard.h"
+#include <cassert>
+
+// The table starts out small enough to be nearly free for an empty board and doubles whenever it gets half full
+static const int cInitialTableCapacity = 64;
+static const int cInitialTableShift = 58;	// 64 - log2(cInitialTableCapacity)
+static const int cInitialHistoryCapacity = 64;
+
+// The four directions a line can run in. The other four are covered by counting backwards along each of these
+static const int cLineDirections[4][2] = { {1, 0}, {0, 1}, {1, 1}, {1, -1} };
+
+SparseBoard::SparseBoard(int width, int height, int winLength)
+{
+	assert(width >= 0 && width <= cMaxBoardSize);
+	assert(height >= 0 && height <= cMaxBoardSize);
+	assert(winLength > 2);
+
+	iWidth = width;
+	iHeight = height;
+	iWinLength = winLength;
+
+	iTableCapacity = cInitialTableCapacity;
+	iTableShift = cInitialTableShift;
+	pSlots = new Slot[iTableCapacity];
+
+	iHistoryCapacity = cInitialHistoryCapacity;
+	pHistory = new Move[iHistoryCapacity];
+
+	Reset();
+}
+
+SparseBoard::~SparseBoard()
+{
+	delete[] pSlots;
+	delete[] pHistory;
+}
+
+void SparseBoard::Reset()
+{
+	// Shrink back down after a long game so that a fresh board really does cost next to nothing
+	if (iTableCapacity != cInitialTableCapacity)
+	{
+		delete[] pSlots;
+		iTableCapacity = cInitialTableCapacity;
+		iTableShift = cInitialTableShift;
+		pSlots = new Slot[iTableCapacity];
+	}
+	for (int i = 0; i < iTableCapacity; i++)
+	{
+		pSlots[i].piece = ' ';
+	}
+	iNumStones = 0;
+	cWinner = ' ';
+	iWinningMoveIndex = -1;
+}
+
+int SparseBoard::GetWidth() const
+{
+	return iWidth;
+}
+int SparseBoard::GetHeight() const
+{
+	return iHeight;
+}
+int SparseBoard::GetWinLength() const
+{
+	return iWinLength;
+}
+int SparseBoard::GetNumStones() const
+{
+	return iNumStones;
+}
+
+bool SparseBoard::IsOnBoard(int x, int y) const
+{
+	if (x < 0 || y < 0) return false;
+	if (x >= cMaxBoardSize || y >= cMaxBoardSize) return false;
+	if (iWidth != 0 && x >= iWidth) return false;
+	if (iHeight != 0 && y >= iHeight) return false;
+	return true;
+}
+
+char SparseBoard::GetPiece(int x, int y) const
+{
+	int slot = FindSlot(x, y);
+	if (slot == -1) return ' ';
+	return pSlots[slot].piece;
+}
+
+bool SparseBoard::PlacePiece(int x, int y, const char piece)
+{
+	assert(piece != ' ');
+
+	if (!IsOnBoard(x, y)) return false;
+	if (FindSlot(x, y) != -1) return false;
+
+	InsertIntoTable(x, y, piece);
+
+	if (iNumStones == iHistoryCapacity)
+	{
+		Move* newHistory = new Move[iHistoryCapacity * 2];
+		for (int i = 0; i < iNumStones; i++) newHistory[i] = pHistory[i];
+		delete[] pHistory;
+		pHistory = newHistory;
+		iHistoryCapacity *= 2;
+	}
+	pHistory[iNumStones].x = x;
+	pHistory[iNumStones].y = y;
+	pHistory[iNumStones].piece = piece;
+
+	// Only the lines running through the new stone can have changed, so that is all we need to look at
+	if (cWinner == ' ' && LongestLineThrough(x, y, piece) >= iWinLength)
+	{
+		cWinner = piece;
+		iWinningMoveIndex = iNumStones;
+	}
+	iNumStones++;
+	return true;
+}
+
+bool SparseBoard::UndoLastMove()
+{
+	if (iNumStones == 0) return false;
+
+	iNumStones--;
+	RemoveFromTable(pHistory[iNumStones].x, pHistory[iNumStones].y);
+
+	if (iWinningMoveIndex == iNumStones)
+	{
+		cWinner = ' ';
+		iWinningMoveIndex = -1;
+	}
+	return true;
+}
+
+bool SparseBoard::GetLastMove(int* x, int* y, char* piece) const
+{
+	assert(x != NULL);
+	assert(y != NULL);
+	assert(piece != NULL);
+
+	if (iNumStones == 0) return false;
+
+	*x = pHistory[iNumStones - 1].x;
+	*y = pHistory[iNumStones - 1].y;
+	*piece = pHistory[iNumStones - 1].piece;
+	return true;
+}
+
+char SparseBoard::GetWinner() const
+{
+	return cWinner;
+}
+
+bool SparseBoard::IsFull() const
+{
+	if (iWidth == 0 || iHeight == 0) return false;
+	return (int64_t)iNumStones >= (int64_t)iWidth * iHeight;
+}
+
+bool SparseBoard::GetBoundingBox(int* minX, int* minY, int* maxX, int* maxY) const
+{
+	assert(minX != NULL && minY != NULL);
+	assert(maxX != NULL && maxY != NULL);
+
+	if (iNumStones == 0) return false;
+
+	*minX = *maxX = pHistory[0].x;
+	*minY = *maxY = pHistory[0].y;
+	for (int i = 1; i < iNumStones; i++)
+	{
+		if (pHistory[i].x < *minX) *minX = pHistory[i].x;
+		if (pHistory[i].x > *maxX) *maxX = pHistory[i].x;
+		if (pHistory[i].y < *minY) *minY = pHistory[i].y;
+		if (pHistory[i].y > *maxY) *maxY = pHistory[i].y;
+	}
+	return true;
+}
+
+bool SparseBoard::CalculateBestMove(const char piece, const char opponentPiece, int* x, int* y) const
+{
+	assert(x != NULL);
+	assert(y != NULL);
+
+	if (IsFull()) return false;
+
+	if (iNumStones == 0)
+	{
+		// Nothing to respond to, so take the middle (or the corner, if the board has no middle)
+		*x = iWidth / 2;
+		*y = iHeight / 2;
+		return true;
+	}
+
+	// Every square worth playing on is next to a stone that is already down. A square can be looked at more than once
+	// when it neighbours several stones, but that still keeps the work proportional to the number of stones
+	int bestScore = -1;
+	for (int i = 0; i < iNumStones; i++)
+	{
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				int candidateX = pHistory[i].x + dx;
+				int candidateY = pHistory[i].y + dy;
+				if (!IsOnBoard(candidateX, candidateY)) continue;
+				if (FindSlot(candidateX, candidateY) != -1) continue;
+
+				int score = ScoreCandidateMove(candidateX, candidateY, piece, opponentPiece);
+				if (score > bestScore)
+				{
+					bestScore = score;
+					*x = candidateX;
+					*y = candidateY;
+				}
+			}
+		}
+	}
+
+	// If every neighbour of every stone is taken then the stones cover the whole (bounded) board
+	return bestScore != -1;
+}
+
+int SparseBoard::HomeSlot(int x, int y) const
+{
+	// Fibonacci hashing of the packed coordinates. The top bits of the product are the best mixed
+	uint64_t key = ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+	return (int)((key * 0x9E3779B97F4A7C15ull) >> iTableShift);
+}
+
+int SparseBoard::FindSlot(int x, int y) const
+{
+	int mask = iTableCapacity - 1;
+	for (int slot = HomeSlot(x, y); pSlots[slot].piece != ' '; slot = (slot + 1) & mask)
+	{
+		if (pSlots[slot].x == x && pSlots[slot].y == y) return slot;
+	}
+	return -1;
+}
+
+void SparseBoard::InsertIntoTable(int x, int y, const char piece)
+{
+	if ((iNumStones + 1) * 2 > iTableCapacity) GrowTable();
+
+	int mask = iTableCapacity - 1;
+	int slot = HomeSlot(x, y);
+	while (pSlots[slot].piece != ' ') slot = (slot + 1) & mask;
+
+	pSlots[slot].x = x;
+	pSlots[slot].y = y;
+	pSlots[slot].piece = piece;
+}
+
+void SparseBoard::RemoveFromTable(int x, int y)
+{
+	int hole = FindSlot(x, y);
+	assert(hole != -1);
+
+	// Backward shift deletion, so that linear probing never needs tombstones. Any entry further along the probe
+	// sequence that would no longer be reachable through the hole gets moved into it
+	int mask = iTableCapacity - 1;
+	for (int next = (hole + 1) & mask; pSlots[next].piece != ' '; next = (next + 1) & mask)
+	{
+		int home = HomeSlot(pSlots[next].x, pSlots[next].y);
+		if (((next - home) & mask) >= ((next - hole) & mask))
+		{
+			pSlots[hole] = pSlots[next];
+			hole = next;
+		}
+	}
+	pSlots[hole].piece = ' ';
+}
+
+void SparseBoard::GrowTable()
+{
+	Slot* oldSlots = pSlots;
+	int oldCapacity = iTableCapacity;
+
+	iTableCapacity *= 2;
+	iTableShift--;
+	pSlots = new Slot[iTableCapacity];
+	for (int i = 0; i < iTableCapacity; i++)
+	{
+		pSlots[i].piece = ' ';
+	}
+
+	int mask = iTableCapacity - 1;
+	for (int i = 0; i < oldCapacity; i++)
+	{
+		if (oldSlots[i].piece == ' ') continue;
+
+		int slot = HomeSlot(oldSlots[i].x, oldSlots[i].y);
+		while (pSlots[slot].piece != ' ') slot = (slot + 1) & mask;
+		pSlots[slot] = oldSlots[i];
+	}
+	delete[] oldSlots;
+}
+
+int SparseBoard::CountInDirection(int x, int y, int dx, int dy, const char piece) const
+{
+	// No point counting past the win length, it can't make any difference
+	int count = 0;
+	for (int i = 1; i < iWinLength; i++)
+	{
+		if (GetPiece(x + dx * i, y + dy * i) != piece) break;
+		count++;
+	}
+	return count;
+}
+
+int SparseBoard::LongestLineThrough(int x, int y, const char piece) const
+{
+	int longest = 0;
+	for (int d = 0; d < 4; d++)
+	{
+		int dx = cLineDirections[d][0];
+		int dy = cLineDirections[d][1];
+		int length = 1 + CountInDirection(x, y, dx, dy, piece) + CountInDirection(x, y, -dx, -dy, piece);
+		if (length > longest) longest = length;
+	}
+	return longest;
+}
+
+// Same priorities as the dense board: win if we can, otherwise block, otherwise build up our own lines while
+// getting in the way of theirs
+int SparseBoard::ScoreCandidateMove(int x, int y, const char piece, const char opponentPiece) const
+{
+	int score = 0;
+	for (int d = 0; d < 4; d++)
+	{
+		int dx = cLineDirections[d][0];
+		int dy = cLineDirections[d][1];
+		int ownLength = 1 + CountInDirection(x, y, dx, dy, piece) + CountInDirection(x, y, -dx, -dy, piece);
+		int theirLength = 1 + CountInDirection(x, y, dx, dy, opponentPiece) + CountInDirection(x, y, -dx, -dy, opponentPiece);
+
+		if (ownLength >= iWinLength) return 1 << 30;
+		if (theirLength >= iWinLength) score += 1 << 20;
+
+		score += ownLength * ownLength * 2 + theirLength * theirLength;
+	}
+	return score;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// A sparse board for the m,n,k (gomoku style) variation of the game. The dense TicTacToeBoard keeps one char per square,
+// which is fine up to 12x12 but grows with the area of the board. This board only stores the squares that are actually
+// occupied, in a small open addressing hash table keyed on the (x,y) coordinates, so memory and the cost of win checks
+// and move generation depend on the number of stones played rather than on the size of the board.
+//
+// A width or height of zero means the board is unbounded in that direction. Coordinates are never negative, since that
+// is all the input parsing supports, and never reach cMaxBoardSize, so "unbounded" really means a billion squares.
+
+class SparseBoard
+{
+public:
+
+	// No coordinate can be this big, even on an unbounded board. That leaves plenty of headroom above the last square,
+	// so stepping along a line or around the edge of the view can never overflow an int
+	static const int cMaxBoardSize = 1000000000;
+
+	SparseBoard(int width, int height, int winLength);
+	~SparseBoard();
+
+	void Reset();
+
+	int GetWidth() const;
+	int GetHeight() const;
+	int GetWinLength() const;
+	int GetNumStones() const;
+
+	bool IsOnBoard(int x, int y) const;
+	// Returns ' ' for an empty (or off board) square, otherwise the piece that occupies it
+	char GetPiece(int x, int y) const;
+
+	// Returns true if the piece was placed, false if the square was off the board or already taken
+	bool PlacePiece(int x, int y, const char piece);
+	// Removes the most recent stone. Returns false if the board was already empty
+	bool UndoLastMove();
+	bool GetLastMove(int* x, int* y, char* piece) const;
+
+	// Returns the piece that has made a line of winLength, or ' ' if nobody has yet
+	char GetWinner() const;
+	// An unbounded board can never fill up, so it can never be a draw
+	bool IsFull() const;
+
+	// Returns false if there are no stones on the board
+	bool GetBoundingBox(int* minX, int* minY, int* maxX, int* maxY) const;
+
+	// Only empty squares next to an existing stone are considered, so this is proportional to the number of stones.
+	// Returns false if there is no legal move left
+	bool CalculateBestMove(const char piece, const char opponentPiece, int* x, int* y) const;
+
+private:
+
+	// Revoke copy construction and assignment
+	SparseBoard(const SparseBoard&);
+	SparseBoard& operator=(const SparseBoard& rhs);
+
+	struct Slot
+	{
+		int x, y;
+		// ' ' marks an unused slot, same as an empty square on the dense board
+		char piece;
+	};
+
+	struct Move
+	{
+		int x, y;
+		char piece;
+	};
+
+	int HomeSlot(int x, int y) const;
+	int FindSlot(int x, int y) const;
+	void InsertIntoTable(int x, int y, const char piece);
+	void RemoveFromTable(int x, int y);
+	void GrowTable();
+
+	// Counts the consecutive pieces starting next to (x,y) and heading in the direction (dx,dy)
+	int CountInDirection(int x, int y, int dx, int dy, const char piece) const;
+	int LongestLineThrough(int x, int y, const char piece) const;
+	int ScoreCandidateMove(int x, int y, const char piece, const char opponentPiece) const;
+
+	int iWidth, iHeight, iWinLength;
+
+	// The open addressing table. The capacity is always a power of two and is kept at most half full
+	Slot* pSlots = NULL;
+	int iTableCapacity;
+	int iTableShift;
+
+	// The history of the stones played, in order. This doubles as the list of occupied squares
+	Move* pHistory = NULL;
+	int iHistoryCapacity;
+	int iNumStones;
+
+	char cWinner;
+	int iWinningMoveIndex;
+};
@@ -1,17 +1,211 @@
 // This is an implementation of TicTacToe for Windows Console. This was written by Max Elliott as part of a programming test/assignment for 
 // Psyonix in February of 2021
 #include "TicTacToeBoard.h"
+#include "PatternEvaluator.h"
+#include "AnalysisCache.h"
+#include "Arena.h"
+#include <cstdlib>
+#include <thread>
+
+// The pattern evaluator weights are looked for here unless --patterns <file> says otherwise
+static const char* cDefaultPatternsFileName = "patterns.bin";
+
+// Size of a newly created analysis cache file. 16 bytes an entry, so this is 16MB
+static const int cAnalysisCacheEntries = 1 << 20;
+
+// Arena games start with this many random moves, so that deterministic engines don't play the same game every time
+static const int cArenaOpeningPlies = 2;
+static const unsigned int cArenaSeed = 1;
+
+// The arena self check plays a searching engine against the fixed rules on a 4x4 board, which the search should win
+// clearly. If it doesn't, then the arena (or the win rule it depends on) can't tell engines apart any more
+static const int cArenaCheckBoardSize = 4;
+static const int cArenaCheckOpenings = 20;
 
 
 // The code should essentially be self documenting, but if I have time, I will add some simple HTML docs
-int main()
+int main(int argc, char* argv[])
 {
+	// --cache <file> shares the computer's analysis with every other game using the same file, and keeps it for next time
+	// --engine <spec> sets how the computer plays, using the same specs as the arena, so its winner can be used for real
+	const char* patternsFileName = cDefaultPatternsFileName;
+	const char* cacheFileName = NULL;
+	const char* engineSpec = NULL;
+	bool ansiRendering = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--ansi") ansiRendering = true;
+		if (i + 1 == argc) continue;
+		if (std::string(argv[i]) == "--patterns") patternsFileName = argv[i + 1];
+		if (std::string(argv[i]) == "--cache") cacheFileName = argv[i + 1];
+		if (std::string(argv[i]) == "--engine") engineSpec = argv[i + 1];
+	}
+
+	// Offline training of the pattern evaluator: --train <weights file> <width>,<height> <number of games>
+	// Training carries on from the existing weights if the file is already there
+	if (argc == 5 && std::string(argv[1]) == "--train")
+	{
+		int width, height;
+		int numGames = atoi(argv[4]);
+		if (sscanf_s(argv[3], "%u,%u", &width, &height) != 2 || numGames <= 0)
+		{
+			std::cout << "Usage: TicTacToe --train <weights file> <width>,<height> <number of games>\n";
+			return 1;
+		}
+
+		PatternEvaluator evaluator;
+		if (evaluator.LoadFromFile(argv[2]))
+		{
+			// Weights for another size of board would be no head start, and we mustn't write over them either
+			if (!evaluator.IsTrainedFor(width, height))
+			{
+				std::cout << argv[2] << " holds weights for a " << evaluator.GetBoardWidth() << "x" << evaluator.GetBoardHeight() <<
+					" board. Please train a " << width << "x" << height << " board into a different file\n";
+				return 1;
+			}
+			std::cout << "Continuing training from " << argv[2] << "\n";
+		}
+
+		TicTacToeBoard trainingBoard(width, height);
+		trainingBoard.TrainEvaluatorBySelfPlay(&evaluator, numGames, 1);
+		if (!evaluator.SaveToFile(argv[2]))
+		{
+			std::cout << "Could not write " << argv[2] << "\n";
+			return 1;
+		}
+		std::cout << "Saved the trained weights to " << argv[2] << "\n";
+		return 0;
+	}
+
+	// Checks that the arena can tell a stronger engine from a weaker one: --arena-check
+	// Both engines are depth limited rather than timed, so the result is the same on any machine
+	if (argc >= 2 && std::string(argv[1]) == "--arena-check")
+	{
+		Arena arena(cArenaCheckBoardSize, cArenaCheckBoardSize, NULL);
+		arena.AddEngine("heuristic");
+		arena.AddEngine("depth=4");
+		arena.Run(cArenaCheckOpenings, cArenaOpeningPlies, cArenaSeed, 1);
+		arena.PrintReport();
+
+		// The 95% confidence interval has to be clear of an even score
+		double interval;
+		double score = arena.GetScore(1, &interval);
+		if (score - interval <= 0.5)
+		{
+			std::cout << "\nFAILED: depth=4 should have beaten heuristic\n";
+			return 1;
+		}
+		std::cout << "\nPassed: depth=4 beat heuristic\n";
+		return 0;
+	}
+
+	// Engine against engine tournament: --arena <width>,<height> <number of openings> [engine spec...]
+	if (argc >= 4 && std::string(argv[1]) == "--arena")
+	{
+		int width, height;
+		int numOpenings = atoi(argv[3]);
+		if (sscanf_s(argv[2], "%u,%u", &width, &height) != 2 || width < 3 || height < 3 || numOpenings <= 0)
+		{
+			std::cout << "Usage: TicTacToe --arena <width>,<height> <number of openings> [engine spec...]\n";
+			std::cout << "An engine spec is a '+' separated list of heuristic, patterns, depth=N and time=MS\n";
+			return 1;
+		}
+
+		PatternEvaluator evaluator;
+		bool haveWeights = evaluator.LoadFromFile(patternsFileName) && evaluator.IsTrainedFor(width, height);
+
+		Arena arena(width, height, &evaluator);
+		for (int i = 4; i < argc; i++)
+		{
+			// Skip over the options, and the file names that go with them
+			std::string arg = argv[i];
+			if (arg == "--ansi") continue;
+			if (arg == "--patterns" || arg == "--cache" || arg == "--engine")
+			{
+				i++;
+				continue;
+			}
+
+			EngineSettings settings;
+			if (!Arena::ParseEngineSpec(arg, &settings) || !arena.AddEngine(arg))
+			{
+				std::cout << "Didn't understand the engine spec " << arg << "\n";
+				return 1;
+			}
+			// Without weights a patterns engine would just be the fixed rules under another name
+			if (settings.bUsePatterns && !haveWeights)
+			{
+				std::cout << "The engine spec " << arg << " needs pattern weights for a " << width << "x" << height <<
+					" board, but there are none in " << patternsFileName << "\n";
+				return 1;
+			}
+		}
+
+		// With no engines given, line up the original rules against a few searches
+		if (arena.GetNumEngines() < 2)
+		{
+			arena.AddEngine("heuristic");
+			arena.AddEngine("depth=2");
+			arena.AddEngine("time=20");
+			if (haveWeights)
+			{
+				arena.AddEngine("patterns");
+				arena.AddEngine("patterns+depth=2");
+			}
+		}
+
+		int numThreads = (int)std::thread::hardware_concurrency();
+		if (numThreads < 1) numThreads = 1;
+		arena.Run(numOpenings, cArenaOpeningPlies, cArenaSeed, numThreads);
+		arena.PrintReport();
+		return 0;
+	}
+
 	std::cout << "Welcome to the TicTacToe Game!\n";
 
 	// To start things off, I am just going to create and test a 3x3 game
 	TicTacToeBoard* theGame = new TicTacToeBoard(3, 3);
 
+	PatternEvaluator evaluator;
+	bool haveWeights = evaluator.LoadFromFile(patternsFileName);
+	if (haveWeights)
+	{
+		std::cout << "Loaded the pattern evaluator weights for a " << evaluator.GetBoardWidth() << "x" << evaluator.GetBoardHeight() <<
+			" board from " << patternsFileName << "\n";
+		theGame->SetEvaluator(&evaluator);
+	}
+
+	if (engineSpec != NULL)
+	{
+		EngineSettings settings;
+		if (!Arena::ParseEngineSpec(engineSpec, &settings))
+		{
+			std::cout << "Didn't understand the engine spec " << engineSpec << "\n";
+			std::cout << "An engine spec is a '+' separated list of heuristic, patterns, depth=N and time=MS\n";
+			return 1;
+		}
+		if (settings.bUsePatterns && !haveWeights)
+		{
+			std::cout << "The engine spec " << engineSpec << " asks for patterns, but there are no weights to use, so the computer will play without them\n";
+		}
+		theGame->SetEngineSettings(settings);
+	}
+
+	AnalysisCache analysisCache;
+	if (cacheFileName != NULL)
+	{
+		if (analysisCache.Open(cacheFileName, cAnalysisCacheEntries))
+		{
+			theGame->SetAnalysisCache(&analysisCache);
+		}
+		else
+		{
+			std::cout << "Could not open the analysis cache " << cacheFileName << ", carrying on without it\n";
+		}
+	}
+
 	TicTacToeBoard::PrintHelp();
+	theGame->SetAnsiRendering(ansiRendering);
 	theGame->PrintBoard();
 
 	while (!theGame->IsTimeToQuit())
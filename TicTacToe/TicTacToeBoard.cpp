@@ -1,5 +1,46 @@
 #include "TicTacToeBoard.h"
 #include <cassert>
+#include <cstring>
+#include <string>
+#include <chrono>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+// SplitMix64, used to make up the Zobrist keys. The keys have to come out the same in every process that shares an
+// analysis cache, so they are derived from the square and piece rather than from a random seed
+static uint64_t MixBits(uint64_t value)
+{
+	value += 0x9E3779B97F4A7C15ull;
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+	return value ^ (value >> 31);
+}
+
+static uint64_t ZobristKey(int location, const char piece)
+{
+	return MixBits(((uint64_t)location << 8) | (unsigned char)piece);
+}
+
+// The hash of an empty board depends on its size, so that the same squares on different sized boards never match
+static uint64_t EmptyBoardKey(int width, int height)
+{
+	return MixBits(((uint64_t)1 << 48) | ((uint64_t)width << 24) | (uint64_t)height);
+}
+
+// How often (in plies) the move tree keeps a full copy of the board, which bounds the work needed to seek to any ply
+static const int cSnapshotInterval = 8;
+
+// Search scores. A win is worth more than any evaluation, and a sooner win is worth more than a later one
+static const float cSearchWinScore = 1000.0f;
+// How many nodes the search visits between looks at the clock
+static const int cSearchClockCheckInterval = 256;
+
+// The sparse board can be far bigger than the screen, so only a window of it gets printed
+static const int cMaxSparseViewSize = 20;
 
 // We will need a few things as part of the core architecture/functionality
 // 1) A data structure to represent the state of the board
@@ -34,7 +75,7 @@ TicTacToeBoard::TicTacToeBoard(int width, int height)
 TicTacToeBoard::~TicTacToeBoard()
 {
 	delete[] cBoard;
-	delete[] iMoves;
+	delete pSparseBoard;
 }
 
 void TicTacToeBoard::ResizeBoard(int width, int height)
@@ -43,20 +84,76 @@ void TicTacToeBoard::ResizeBoard(int width, int height)
 	assert(height > 2);
 
 	delete[] cBoard;
-	delete[] iMoves;
+	delete pSparseBoard;
+	pSparseBoard = NULL;
 	iBoardWidth = width;
 	iBoardHeight = height;
 	CheckAndAdjustSizes();
 	AllocateBoardMemory();
 }
 
+void TicTacToeBoard::SwitchToSparseBoard(int width, int height, int winLength)
+{
+	// The dense board is not needed in sparse mode, and on a large board it is exactly the memory we are trying to save
+	delete[] cBoard;
+	cBoard = NULL;
+	iNumMovesMadeSoFar = 0;
+	vMoveTree.clear();
+	vSnapshots.clear();
+	vSnapshotSquares.clear();
+	vCurrentLine.clear();
+	iStatusNode = -1;
+
+	delete pSparseBoard;
+	pSparseBoard = new SparseBoard(width, height, winLength);
+	iBoardWidth = width;
+	iBoardHeight = height;
+}
+
 void TicTacToeBoard::ResetBoard()
 {
+	if (pSparseBoard != NULL)
+	{
+		pSparseBoard->Reset();
+		return;
+	}
+
 	for (int i = 0; i < iBoardWidth * iBoardHeight; i++)
 	{
 		cBoard[i] = ' ';
 	}
 	iNumMovesMadeSoFar = 0;
+	iBoardHash = EmptyBoardKey(iBoardWidth, iBoardHeight);
+
+	// A new game gets a new tree, with just the empty board at the root
+	vMoveTree.clear();
+	vSnapshots.clear();
+	vSnapshotSquares.clear();
+	vCurrentLine.clear();
+
+	MoveNode root;
+	root.location = -1;
+	root.piece = ' ';
+	root.ply = 0;
+	root.parent = -1;
+	root.firstChild = -1;
+	root.nextSibling = -1;
+	root.redoChild = -1;
+	root.snapshot = -1;
+	root.playerHasLine = false;
+	root.computerHasLine = false;
+	vMoveTree.push_back(root);
+	TakeSnapshot(0);
+	vCurrentLine.push_back(0);
+	iStatusNode = 0;
+}
+
+void TicTacToeBoard::SetSquare(int location, const char piece)
+{
+	iStatusNode = -1;
+	if (cBoard[location] != ' ') iBoardHash ^= ZobristKey(location, cBoard[location]);
+	cBoard[location] = piece;
+	if (piece != ' ') iBoardHash ^= ZobristKey(location, piece);
 }
 
 void TicTacToeBoard::PlacePlayerPiece(int location)
@@ -64,13 +161,12 @@ void TicTacToeBoard::PlacePlayerPiece(int location)
 	assert(location >= 0 && location < iBoardHeight* iBoardWidth);
 	assert(iNumMovesMadeSoFar < iBoardHeight* iBoardWidth);
 
-	cBoard[location] = cPlayerPiece;
-	iMoves[iNumMovesMadeSoFar++] = location;
+	RecordMove(location, cPlayerPiece);
 	PrintBoard();
 	if (DidSomeoneWin(cPlayerPiece) || IsGameADraw()) return;
 
 	std::cout << "It is now the Computer's turn...\n";
-	int computerMoveLocation = CalculateBestComputerMove();
+	int computerMoveLocation = CalculateBestMove(cComputerPiece);
 	PlaceComputerPiece(computerMoveLocation);
 	PrintBoard();
 }
@@ -79,8 +175,181 @@ void TicTacToeBoard::PlaceComputerPiece(int location)
 	assert(location >= 0 && location < iBoardHeight* iBoardWidth);
 	assert(iNumMovesMadeSoFar < iBoardHeight* iBoardWidth);
 
-	cBoard[location] = cComputerPiece;
-	iMoves[iNumMovesMadeSoFar++] = location;
+	RecordMove(location, cComputerPiece);
+}
+
+void TicTacToeBoard::RecordMove(int location, const char piece)
+{
+	int parent = vCurrentLine[iNumMovesMadeSoFar];
+
+	// If this move has been played from here before then we are just going back down that branch, so reuse it
+	int child = vMoveTree[parent].firstChild;
+	while (child != -1 && (vMoveTree[child].location != location || vMoveTree[child].piece != piece))
+	{
+		child = vMoveTree[child].nextSibling;
+	}
+
+	SetSquare(location, piece);
+	iNumMovesMadeSoFar++;
+
+	if (child == -1)
+	{
+		MoveNode node;
+		node.location = location;
+		node.piece = piece;
+		node.ply = iNumMovesMadeSoFar;
+		node.parent = parent;
+		node.firstChild = -1;
+		node.nextSibling = vMoveTree[parent].firstChild;
+		node.redoChild = -1;
+		node.snapshot = -1;
+		// A line, once made, stays made further down the tree, and the only new line there can be is one of ours
+		node.playerHasLine = vMoveTree[parent].playerHasLine || (piece == cPlayerPiece && ScanForWin(piece));
+		node.computerHasLine = vMoveTree[parent].computerHasLine || (piece == cComputerPiece && ScanForWin(piece));
+		child = (int)vMoveTree.size();
+		vMoveTree.push_back(node);
+		vMoveTree[parent].firstChild = child;
+
+		if (iNumMovesMadeSoFar % cSnapshotInterval == 0) TakeSnapshot(child);
+	}
+	vMoveTree[parent].redoChild = child;
+	iStatusNode = child;
+
+	// If we are still on the same line, everything after this move is kept for redo. Otherwise the line now follows
+	// this branch, as far as it was last played
+	if ((int)vCurrentLine.size() > iNumMovesMadeSoFar && vCurrentLine[iNumMovesMadeSoFar] == child) return;
+	FollowLineThrough(child);
+}
+
+void TicTacToeBoard::FollowLineThrough(int node)
+{
+	vCurrentLine.resize(vMoveTree[node].ply);
+	for (; node != -1; node = vMoveTree[node].redoChild)
+	{
+		vCurrentLine.push_back(node);
+	}
+}
+
+void TicTacToeBoard::TakeSnapshot(int node)
+{
+	BoardSnapshot snapshot;
+	snapshot.hash = iBoardHash;
+	snapshot.squaresOffset = vSnapshotSquares.size();
+	vSnapshotSquares.insert(vSnapshotSquares.end(), cBoard, cBoard + iBoardWidth * iBoardHeight);
+
+	vMoveTree[node].snapshot = (int)vSnapshots.size();
+	vSnapshots.push_back(snapshot);
+}
+
+bool TicTacToeBoard::SeekToPly(int ply)
+{
+	if (pSparseBoard != NULL) return false;
+	if (ply < 0 || ply >= (int)vCurrentLine.size()) return false;
+
+	// Every cSnapshotInterval plies along any line there is a copy of the board, so we only ever have to put that
+	// back and replay fewer than cSnapshotInterval moves on top of it, however long the game is
+	int snapshotPly = ply - ply % cSnapshotInterval;
+	const BoardSnapshot& snapshot = vSnapshots[vMoveTree[vCurrentLine[snapshotPly]].snapshot];
+	memcpy(cBoard, &vSnapshotSquares[snapshot.squaresOffset], iBoardWidth * iBoardHeight);
+	iBoardHash = snapshot.hash;
+
+	for (int p = snapshotPly + 1; p <= ply; p++)
+	{
+		const MoveNode& node = vMoveTree[vCurrentLine[p]];
+		SetSquare(node.location, node.piece);
+	}
+	iNumMovesMadeSoFar = ply;
+	iStatusNode = vCurrentLine[ply];
+	return true;
+}
+
+int TicTacToeBoard::GetNumPliesInLine() const
+{
+	return (int)vCurrentLine.size() - 1;
+}
+
+int TicTacToeBoard::GetNumVariations() const
+{
+	if (pSparseBoard != NULL) return 0;
+
+	int numVariations = 0;
+	for (int child = vMoveTree[vCurrentLine[iNumMovesMadeSoFar]].firstChild; child != -1; child = vMoveTree[child].nextSibling)
+	{
+		numVariations++;
+	}
+	return numVariations;
+}
+
+void TicTacToeBoard::PrintVariations() const
+{
+	if (GetNumVariations() == 0)
+	{
+		std::cout << "No moves have been played from here yet\n";
+		return;
+	}
+
+	int next = iNumMovesMadeSoFar + 1 < (int)vCurrentLine.size() ? vCurrentLine[iNumMovesMadeSoFar + 1] : -1;
+	int variation = 1;
+	for (int child = vMoveTree[vCurrentLine[iNumMovesMadeSoFar]].firstChild; child != -1; child = vMoveTree[child].nextSibling)
+	{
+		int numMoves = 0;
+		for (int node = child; node != -1; node = vMoveTree[node].redoChild) numMoves++;
+
+		const MoveNode& node = vMoveTree[child];
+		std::cout << "    " << variation << ": " << node.piece << " at " << WhichColumn(node.location) << "," <<
+			WhichRow(node.location) << ", " << numMoves << (numMoves == 1 ? " move" : " moves") <<
+			(child == next ? " (the current line)\n" : "\n");
+		variation++;
+	}
+}
+
+bool TicTacToeBoard::SwitchToVariation(int variation)
+{
+	if (pSparseBoard != NULL) return false;
+
+	int parent = vCurrentLine[iNumMovesMadeSoFar];
+	int child = vMoveTree[parent].firstChild;
+	for (int i = 1; i < variation && child != -1; i++)
+	{
+		child = vMoveTree[child].nextSibling;
+	}
+	if (variation < 1 || child == -1) return false;
+
+	vMoveTree[parent].redoChild = child;
+	FollowLineThrough(child);
+	return true;
+}
+
+bool TicTacToeBoard::Redo()
+{
+	if (pSparseBoard != NULL) return false;
+
+	// Forward to the next time it is the player's turn, or as far as the line goes if it ends before then
+	int target = iNumMovesMadeSoFar + 2 - iNumMovesMadeSoFar % 2;
+	if (target > GetNumPliesInLine()) target = GetNumPliesInLine();
+	if (target <= iNumMovesMadeSoFar) return false;
+
+	SeekToPly(target);
+	return true;
+}
+
+void TicTacToeBoard::PlaceSparsePlayerPiece(int x, int y)
+{
+	assert(pSparseBoard != NULL);
+
+	bool placed = pSparseBoard->PlacePiece(x, y, cPlayerPiece);
+	assert(placed);
+	PrintBoard();
+	if (DidSomeoneWin(cPlayerPiece) || IsGameADraw()) return;
+
+	std::cout << "It is now the Computer's turn...\n";
+	int computerX, computerY;
+	if (pSparseBoard->CalculateBestMove(cComputerPiece, cPlayerPiece, &computerX, &computerY))
+	{
+		placed = pSparseBoard->PlacePiece(computerX, computerY, cComputerPiece);
+		assert(placed);
+	}
+	PrintBoard();
 }
 
 // Implementing all the safety checks as internal to the class so that misuse or error is difficult
@@ -102,7 +371,6 @@ void TicTacToeBoard::CheckAndAdjustSizes()
 void TicTacToeBoard::AllocateBoardMemory()
 {
 	cBoard = new char[iBoardWidth * iBoardHeight];
-	iMoves = new int[iBoardWidth * iBoardHeight];
 	iNumMovesMadeSoFar = 0;
 	ResetBoard();
 }
@@ -118,51 +386,222 @@ bool TicTacToeBoard::IsLegalPlayerMove(int moveLocation) const
 	return false;
 }
 
+// Works out which part of one axis of the sparse board to show. That is the whole axis if it is small enough,
+// otherwise the stones plus a one square margin, centered on the last move if even that is too big
+static void CalculateSparseViewRange(int minStone, int maxStone, int lastStone, int boardSize, int* first, int* last)
+{
+	// An unbounded axis still stops short of cMaxBoardSize, so never show anything past that
+	if (boardSize == 0) boardSize = SparseBoard::cMaxBoardSize;
+
+	if (boardSize <= cMaxSparseViewSize)
+	{
+		*first = 0;
+		*last = boardSize - 1;
+		return;
+	}
+
+	*first = minStone - 1;
+	*last = maxStone + 1;
+	if (*last - *first + 1 > cMaxSparseViewSize)
+	{
+		*first = lastStone - cMaxSparseViewSize / 2;
+		*last = *first + cMaxSparseViewSize - 1;
+	}
+	if (*first < 0)
+	{
+		*last -= *first;
+		*first = 0;
+	}
+	if (*last >= boardSize)
+	{
+		*first -= *last - (boardSize - 1);
+		*last = boardSize - 1;
+	}
+}
+
+static int NumDigits(int value)
+{
+	int digits = 1;
+	while (value >= 10)
+	{
+		value /= 10;
+		digits++;
+	}
+	return digits;
+}
+
+static void AppendPadded(std::string& out, int value, int width)
+{
+	std::string digits = std::to_string(value);
+	if ((int)digits.size() < width) out.append(width - digits.size(), ' ');
+	out += digits;
+}
+
+// The whole frame is built up in sFrameBuffer and written out with a single write. The buffer is kept from frame to
+// frame so that, after the first one, drawing the board doesn't allocate anything either
 void TicTacToeBoard::PrintBoard() const {
 
-	// Print the column numbers
-	std::cout << "  ";
-	for (int x = 0; x < iBoardWidth; x++)
+	// Work out which squares are on screen. That's all of them on the dense board
+	int firstColumn = 0;
+	int lastColumn = iBoardWidth - 1;
+	int firstRow = 0;
+	int lastRow = iBoardHeight - 1;
+	sFrameTitle.clear();
+
+	if (pSparseBoard != NULL)
+	{
+		int minX = 0, minY = 0, maxX = 0, maxY = 0;
+		int lastX = 0, lastY = 0;
+		char lastPiece;
+		pSparseBoard->GetBoundingBox(&minX, &minY, &maxX, &maxY);
+		pSparseBoard->GetLastMove(&lastX, &lastY, &lastPiece);
+		CalculateSparseViewRange(minX, maxX, lastX, pSparseBoard->GetWidth(), &firstColumn, &lastColumn);
+		CalculateSparseViewRange(minY, maxY, lastY, pSparseBoard->GetHeight(), &firstRow, &lastRow);
+
+		sFrameTitle = std::to_string(pSparseBoard->GetWinLength()) + " in a row wins. Showing columns ";
+		sFrameTitle += std::to_string(firstColumn) + "-" + std::to_string(lastColumn);
+		sFrameTitle += " and rows " + std::to_string(firstRow) + "-" + std::to_string(lastRow) + "\n";
+	}
+
+	// Gather up the squares first, so that they can be compared against the last frame
+	int numColumns = lastColumn - firstColumn + 1;
+	int numRows = lastRow - firstRow + 1;
+	sFrameSquares.resize(numColumns * numRows);
+	for (int y = 0; y < numRows; y++)
 	{
-		std::cout << "  " << x << " ";
+		for (int x = 0; x < numColumns; x++)
+		{
+			if (pSparseBoard != NULL) sFrameSquares[y * numColumns + x] = pSparseBoard->GetPiece(firstColumn + x, firstRow + y);
+			else sFrameSquares[y * numColumns + x] = cBoard[y * iBoardWidth + x];
+		}
 	}
-	std::cout << "\n";
 
-	//std::cout << "\n\nHere is the current state of the board:\n\n";
-	PrintRowOfDashes();
+	bool sameLayout = bHaveLastFrame && sFrameTitle == sLastFrameTitle;
+	sameLayout = sameLayout && firstColumn == iLastFrameFirstColumn && firstRow == iLastFrameFirstRow;
+	sameLayout = sameLayout && sFrameSquares.size() == sLastFrameSquares.size() && numColumns == iLastFrameNumColumns;
 
+	sFrameBuffer.clear();
+	if (bAnsiRendering && sameLayout)
+	{
+		AppendChangedSquares(firstColumn, lastColumn, lastRow);
+	}
+	else
+	{
+		AppendFullFrame(firstColumn, lastColumn, firstRow, lastRow);
+	}
+	std::cout.write(sFrameBuffer.data(), sFrameBuffer.size());
+	std::cout.flush();
+
+	sLastFrameSquares.swap(sFrameSquares);
+	sLastFrameTitle.swap(sFrameTitle);
+	iLastFrameFirstColumn = firstColumn;
+	iLastFrameFirstRow = firstRow;
+	iLastFrameNumColumns = numColumns;
+	bHaveLastFrame = true;
+}
 
+void TicTacToeBoard::AppendFullFrame(int firstColumn, int lastColumn, int firstRow, int lastRow) const
+{
+	// The squares and labels widen to fit the coordinates, which only matters for the sparse board
+	int rowLabelWidth = NumDigits(lastRow);
+	int squareWidth = NumDigits(lastColumn) + 1;
+	if (squareWidth < 3) squareWidth = 3;
+	int numColumns = lastColumn - firstColumn + 1;
 
-	for (int y = 0; y < iBoardHeight; y++)
+	// In ANSI mode the board lives at the top of the screen and everything else scrolls underneath it
+	if (bAnsiRendering) sFrameBuffer += "\x1b[r\x1b[H\x1b[2J";
+
+	sFrameBuffer += sFrameTitle;
+
+	// Print the column numbers
+	sFrameBuffer.append(rowLabelWidth + 1, ' ');
+	for (int x = firstColumn; x <= lastColumn; x++)
 	{
-		// Print a row of squares, starting with a vertical dash and some nice spacing between 
-		// each square
+		AppendPadded(sFrameBuffer, x, squareWidth);
+		sFrameBuffer += ' ';
+	}
+	sFrameBuffer += '\n';
 
-		// print the row number
-		std::cout << y << " ";
+	AppendRowOfDashes(rowLabelWidth, numColumns, squareWidth);
 
-		for (int x = 0; x < iBoardWidth; x++)
+	for (int y = firstRow; y <= lastRow; y++)
+	{
+		// Print a row of squares, starting with the row number and a vertical dash and some nice spacing between
+		// each square
+		AppendPadded(sFrameBuffer, y, rowLabelWidth);
+		sFrameBuffer += ' ';
+
+		for (int x = 0; x < numColumns; x++)
 		{
-			std::cout << "| ";
-			std::cout << cBoard[y * iBoardWidth + x];
-			std::cout << " ";
+			sFrameBuffer += "| ";
+			sFrameBuffer += sFrameSquares[(y - firstRow) * numColumns + x];
+			sFrameBuffer.append(squareWidth - 2, ' ');
 		}
 		// Print a final vertical bar after the last square on this row
-		std::cout << "|\n";
+		sFrameBuffer += "|\n";
 
 		// Print a nice row of dashes to separate the next row
-		PrintRowOfDashes();
+		AppendRowOfDashes(rowLabelWidth, numColumns, squareWidth);
 	}
 
+	if (bAnsiRendering)
+	{
+		// Pin the board by setting the scrolling region to start just below it, then park the cursor there
+		int frameLines = (sFrameTitle.empty() ? 0 : 1) + 2 + 2 * (lastRow - firstRow + 1);
+		sFrameBuffer += "\x1b[" + std::to_string(frameLines + 1) + "r";
+		sFrameBuffer += "\x1b[" + std::to_string(frameLines + 1) + ";1H";
+	}
+}
+
+void TicTacToeBoard::AppendChangedSquares(int firstColumn, int lastColumn, int lastRow) const
+{
+	int rowLabelWidth = NumDigits(lastRow);
+	int squareWidth = NumDigits(lastColumn) + 1;
+	if (squareWidth < 3) squareWidth = 3;
+	int numColumns = lastColumn - firstColumn + 1;
+	int titleLines = sFrameTitle.empty() ? 0 : 1;
+
+	// Jump straight to each square that changed and rewrite just that character, then put the cursor back where
+	// it was so the prompt carries on as if nothing happened. Screen rows and columns count from 1
+	sFrameBuffer += "\x1b" "7";
+	for (int i = 0; i < (int)sFrameSquares.size(); i++)
+	{
+		if (sFrameSquares[i] == sLastFrameSquares[i]) continue;
+
+		int screenRow = titleLines + 3 + 2 * (i / numColumns);
+		int screenColumn = rowLabelWidth + 1 + (i % numColumns) * (squareWidth + 1) + 3;
+		sFrameBuffer += "\x1b[" + std::to_string(screenRow) + ";" + std::to_string(screenColumn) + "H";
+		sFrameBuffer += sFrameSquares[i];
+	}
+	sFrameBuffer += "\x1b" "8";
 }
 
-void TicTacToeBoard::PrintRowOfDashes() const
+void TicTacToeBoard::AppendRowOfDashes(int rowLabelWidth, int numColumns, int squareWidth) const
 {
-	std::cout << "  ";
-	for (int x = 0; x < (iBoardWidth * 4) + 1; x++) std::cout << "-";
-	std::cout << "\n";
+	sFrameBuffer.append(rowLabelWidth + 1, ' ');
+	sFrameBuffer.append(numColumns * (squareWidth + 1) + 1, '-');
+	sFrameBuffer += '\n';
 }
 
+void TicTacToeBoard::SetAnsiRendering(bool enabled)
+{
+#ifdef _WIN32
+	// The Windows console only understands the escape codes once it has been asked to
+	if (enabled)
+	{
+		HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+		DWORD mode = 0;
+		if (GetConsoleMode(console, &mode)) SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+	}
+#endif
+
+	// Give the whole screen back to normal scrolling when we stop pinning the board
+	if (bAnsiRendering && !enabled) std::cout << "\x1b[r\n";
+
+	bAnsiRendering = enabled;
+	// Whatever was on screen before can't be trusted, so the next frame is always drawn in full
+	bHaveLastFrame = false;
+}
 
 std::string TicTacToeBoard::AskUserForInput()
 {
@@ -193,6 +632,20 @@ bool TicTacToeBoard::IsInputAValidSize(const std::string input) const
 	return true;
 }
 
+bool TicTacToeBoard::IsInputAValidSparseSize(const std::string input) const
+{
+	int x, y, k;
+	int result = sscanf_s(input.c_str(), "%u,%u,%u", &x, &y, &k);
+
+	if (result != 3) return false;
+
+	// Zero means unbounded. A bounded side still has to be long enough to fit a winning line
+	if (k < 3 || k > 10) return false;
+	if (x < 0 || y < 0 || x > SparseBoard::cMaxBoardSize || y > SparseBoard::cMaxBoardSize) return false;
+	if ((x != 0 && x < k) || (y != 0 && y < k)) return false;
+	return true;
+}
+
 bool TicTacToeBoard::GetInputMoveLocation(const std::string input, int* x, int* y) const
 {
 	assert(x != NULL);
@@ -247,6 +700,17 @@ bool TicTacToeBoard::ProcessInput(const std::string input)
 		bool result = GetInputMoveLocation(input, &x, &y);
 		assert(result);
 
+		if (pSparseBoard != NULL)
+		{
+			if (pSparseBoard->IsOnBoard(x, y) && pSparseBoard->GetPiece(x, y) == ' ')
+			{
+				PlaceSparsePlayerPiece(x, y);
+				return true;
+			}
+			std::cout << "Illegal move, please try again!\n";
+			return false;
+		}
+
 		int location = y * iBoardWidth + x;
 
 		// Attempt to place the player piece
@@ -279,17 +743,131 @@ bool TicTacToeBoard::ProcessInput(const std::string input)
 		bool result = GetInputMoveLocation(inputString, &newWidth, &newHeight);
 
 		std::cout << "New board size is now " << newWidth << "X" << newHeight << "\n";
+		if (pEvaluator != NULL && pEvaluator->HasWeights() && !pEvaluator->IsTrainedFor(newWidth, newHeight))
+		{
+			std::cout << "The pattern weights were trained on a " << pEvaluator->GetBoardWidth() << "X" <<
+				pEvaluator->GetBoardHeight() << " board, so the computer will play without them on this one\n";
+		}
 
 		ResizeBoard(newWidth, newHeight);
 		PrintBoard();
 		return true;
 
 	}
+	else if (input == "sparse")
+	{
+		int newWidth = 0;
+		int newHeight = 0;
+		int winLength = 5;
+		std::string inputString;
+
+		std::cout << "Please enter 'X,Y,K' for the new dimensions and the number in a row needed to win (use 0,0,K for an unbounded board):\n";
+		std::cin >> inputString;
+		while (!IsInputAValidSparseSize(inputString))
+		{
+			std::cout << "Invalid size. Please try again:\n";
+			std::cout << "Please enter 'X,Y,K' (K from 3 to 10, X and Y either 0 or from K up to " + std::to_string(SparseBoard::cMaxBoardSize) + "):\n";
+			std::cin >> inputString;
+		}
+		sscanf_s(inputString.c_str(), "%u,%u,%u", &newWidth, &newHeight, &winLength);
+
+		SwitchToSparseBoard(newWidth, newHeight, winLength);
+		PrintBoard();
+		return true;
+	}
+	else if (input == "ansi")
+	{
+		SetAnsiRendering(!bAnsiRendering);
+		PrintBoard();
+		return true;
+	}
 	else if (input == "undo")
 	{
 		Undo();
 		return true;
 	}
+	else if (input == "redo")
+	{
+		if (pSparseBoard != NULL)
+		{
+			std::cout << "Redo is not available on the sparse board\n";
+			return false;
+		}
+		if (!Redo())
+		{
+			std::cout << "There is nothing to redo\n";
+			return false;
+		}
+		PrintBoard();
+		return true;
+	}
+	else if (input == "goto")
+	{
+		if (pSparseBoard != NULL)
+		{
+			std::cout << "Goto is not available on the sparse board\n";
+			return false;
+		}
+
+		std::string inputString;
+		int ply = -1;
+		std::cout << "Please enter the move number to go to (0 for the start, up to " << GetNumPliesInLine() << "):\n";
+		std::cin >> inputString;
+		if (sscanf_s(inputString.c_str(), "%d", &ply) != 1 || ply < 0 || ply > GetNumPliesInLine())
+		{
+			std::cout << "That is not a move in this game\n";
+			return false;
+		}
+
+		// Always land on a position where it is the player's turn, unless the player's move ended the game
+		if (ply % 2 == 1 && ply < GetNumPliesInLine())
+		{
+			std::cout << "After move " << ply << " it is the Computer's turn, so going back to move " << ply - 1 << " instead\n";
+			ply--;
+		}
+		SeekToPly(ply);
+		PrintBoard();
+		return true;
+	}
+	else if (input == "lines")
+	{
+		if (pSparseBoard != NULL)
+		{
+			std::cout << "Lines are not available on the sparse board\n";
+			return false;
+		}
+		PrintVariations();
+		return true;
+	}
+	else if (input == "switch")
+	{
+		if (pSparseBoard != NULL)
+		{
+			std::cout << "Switch is not available on the sparse board\n";
+			return false;
+		}
+		if (GetNumVariations() == 0)
+		{
+			std::cout << "No moves have been played from here yet\n";
+			return false;
+		}
+
+		std::string inputString;
+		int variation = 0;
+		PrintVariations();
+		std::cout << "Please enter the number of the line to follow (1 to " << GetNumVariations() << "):\n";
+		std::cin >> inputString;
+		if (sscanf_s(inputString.c_str(), "%d", &variation) != 1 || !SwitchToVariation(variation))
+		{
+			std::cout << "That is not one of the lines from here\n";
+			return false;
+		}
+
+		// Play into it, the same as a redo would
+		Redo();
+		PrintBoard();
+		return true;
+	}
 	else if (input == "quit")
 	{
 		Quit();
@@ -303,6 +881,7 @@ bool TicTacToeBoard::ProcessInput(const std::string input)
 }
 void TicTacToeBoard::Quit()
 {
+	SetAnsiRendering(false);
 	std::cout << "Thank you for playing! That was fun! Please coma again. Goodbye for now...\n";
 	std::cout << "Press any key to continue quitting..\n";
 	int junk = getchar();
@@ -316,20 +895,48 @@ bool TicTacToeBoard::IsTimeToQuit() const
 
 void  TicTacToeBoard::Undo()
 {
+	if (pSparseBoard != NULL)
+	{
+		// Back off the computer's reply, if it got to make one, and then the player's move
+		int x, y;
+		char piece;
+		if (pSparseBoard->GetLastMove(&x, &y, &piece) && piece == cComputerPiece) pSparseBoard->UndoLastMove();
+		if (pSparseBoard->GetLastMove(&x, &y, &piece) && piece == cPlayerPiece) pSparseBoard->UndoLastMove();
+		PrintBoard();
+		return;
+	}
+
 	if (iNumMovesMadeSoFar == 0) return;
 
-	// Assume at least two moves have been made, one by the player, followed by one from the computer. Back both of those off
-	cBoard[iMoves[iNumMovesMadeSoFar - 1]] = ' ';
-	iNumMovesMadeSoFar--;
-	cBoard[iMoves[iNumMovesMadeSoFar - 1]] = ' ';
-	iNumMovesMadeSoFar--;
+	// Go back to the last time it was the player's turn. That's normally two moves, the computer's reply and the player's
+	// move before it, but only one if the player's move ended the game before the computer could reply. The moves stay
+	// in the tree, so they can be redone, and playing something different starts a new branch
+	SeekToPly((iNumMovesMadeSoFar - 1) & ~1);
 
 	PrintBoard();
 }
 
 bool TicTacToeBoard::DidSomeoneWin(const char piece) const
 {
-	if (iNumMovesMadeSoFar < 6) return false;
+	// The sparse board checks for a win as each stone goes down, which only costs the lines through that stone
+	if (pSparseBoard != NULL) return pSparseBoard->GetWinner() == piece;
+
+	// Any position in the move tree already knows who has a line
+	if (iStatusNode != -1)
+	{
+		const MoveNode& node = vMoveTree[iStatusNode];
+		if (piece == cPlayerPiece) return node.playerHasLine;
+		if (piece == cComputerPiece) return node.computerHasLine;
+	}
+	return ScanForWin(piece);
+}
+
+bool TicTacToeBoard::ScanForWin(const char piece) const
+{
+	// Nobody can have a full line until the first player has put down as many pieces as the shorter side of the board.
+	// This used to be a flat 6, which missed the first player's win on move 5 of a 3x3 game
+	int shortestSide = iBoardWidth < iBoardHeight ? iBoardWidth : iBoardHeight;
+	if (iNumMovesMadeSoFar < 2 * shortestSide - 1) return false;
 
 	for (int row = 0; row < iBoardHeight; row++)
 	{
@@ -355,6 +962,8 @@ bool TicTacToeBoard::DidSomeoneWin(const char piece) const
 
 bool TicTacToeBoard::IsGameADraw() const
 {
+	if (pSparseBoard != NULL) return pSparseBoard->IsFull() && pSparseBoard->GetWinner() == ' ';
+
 	if (iNumMovesMadeSoFar != iBoardHeight * iBoardWidth) return false;
 
 	if (DidSomeoneWin(cComputerPiece)) return false;
@@ -363,15 +972,57 @@ bool TicTacToeBoard::IsGameADraw() const
 }
 int TicTacToeBoard::WhichRow(int location) const
 {
-	return (int)(location / iBoardHeight);
+	return (int)(location / iBoardWidth);
 }
 int TicTacToeBoard::WhichColumn(int location) const
 {
 	return (int)(location % iBoardWidth);
 }
 
-int TicTacToeBoard::CalculateBestComputerMove() const
+int TicTacToeBoard::CalculateBestMove(const char piece)
+{
+	assert(pSparseBoard == NULL);
+	assert(iNumMovesMadeSoFar < iBoardWidth * iBoardHeight);
+
+	// Only search results are ever stored. The fixed rules and the pattern evaluator take about as long as a lookup, so
+	// there is nothing to gain from sharing them
+	if (pAnalysisCache == NULL || !IsSearchInUse())
+	{
+		bool worthCaching;
+		return AnalyseBestMove(piece, &worthCaching);
+	}
+
+	// A hash collision could hand us a square that is already taken, so check before trusting it
+	uint64_t key = iBoardHash ^ EngineSettingsKey(piece);
+	int location;
+	if (pAnalysisCache->Lookup(key, &location) && IsLegalPlayerMove(location)) return location;
+
+	bool worthCaching;
+	location = AnalyseBestMove(piece, &worthCaching);
+	if (worthCaching) pAnalysisCache->Store(key, location);
+	return location;
+}
+
+uint64_t TicTacToeBoard::EngineSettingsKey(const char piece) const
+{
+	uint64_t key = MixBits(((uint64_t)(unsigned char)piece << 48) | ((uint64_t)stEngineSettings.iSearchDepth << 32) |
+		(uint64_t)(uint32_t)stEngineSettings.iTimeBudgetMs);
+	if (IsEvaluatorInUse())
+	{
+		key ^= MixBits(pEvaluator->GetWeightsChecksum());
+	}
+	return key;
+}
+
+int TicTacToeBoard::AnalyseBestMove(const char piece, bool* worthCaching)
 {
+	assert(worthCaching != NULL);
+	*worthCaching = false;
+
+	char opponent = piece == cPlayerPiece ? cComputerPiece : cPlayerPiece;
+
+	if (IsSearchInUse()) return SearchBestMove(piece, opponent, worthCaching);
+
 	// There are some basic strategies to employ...
 	// First, if the user is about to win, a blocking move should be made
 	// Second, if any row or column can be won by the computer, then pick one of those starting
@@ -383,58 +1034,206 @@ int TicTacToeBoard::CalculateBestComputerMove() const
 	// Check to see if we are about to win any row or column
 	for (int x = 0; x < iBoardWidth; x++)
 	{
-		location = CheckSomeoneAboutToWinCol(x, cComputerPiece);
+		location = CheckSomeoneAboutToWinCol(x, piece);
 		if (location != -1) return location;
 	}
 
 	for (int y = 0; y < iBoardHeight; y++)
 	{
-		location = CheckSomeoneAboutToWinRow(y, cComputerPiece);
+		location = CheckSomeoneAboutToWinRow(y, piece);
 		if (location != -1) return location;
 	}
 
 	// Check if we are about to win diagonally
 	for (int x = 0; x < iBoardWidth; x++)
 	{
-		location = CheckSomeoneAboutToWinDiag(x, true, cComputerPiece);
+		location = CheckSomeoneAboutToWinDiag(x, true, piece);
 		if (location != -1) return location;
-		location = CheckSomeoneAboutToWinDiag(x, false, cComputerPiece);
+		location = CheckSomeoneAboutToWinDiag(x, false, piece);
 		if (location != -1) return location;
 	}
 
 	// Now check for good row and column blocking moves
 	for (int x = 0; x < iBoardWidth; x++)
 	{
-		location = CheckSomeoneAboutToWinCol(x, cPlayerPiece);
+		location = CheckSomeoneAboutToWinCol(x, opponent);
 		if (location != -1) return location;
 	}
 
 	for (int y = 0; y < iBoardHeight; y++)
 	{
-		location = CheckSomeoneAboutToWinRow(y, cPlayerPiece);
+		location = CheckSomeoneAboutToWinRow(y, opponent);
 		if (location != -1) return location;
 	}
 
 	// Check if they are about to win diagonally
 	for (int x = 0; x < iBoardWidth; x++)
 	{
-		location = CheckSomeoneAboutToWinDiag(x, true, cPlayerPiece);
+		location = CheckSomeoneAboutToWinDiag(x, true, opponent);
 		if (location != -1) return location;
-		location = CheckSomeoneAboutToWinDiag(x, false, cPlayerPiece);
+		location = CheckSomeoneAboutToWinDiag(x, false, opponent);
 		if (location != -1) return location;
 	}
 
-	// Just pick a random one for now, later we will pick a 'smart' one
-	int min = 0;
-	int max = iBoardHeight * iBoardWidth - 1;
-	location = min + (rand() % static_cast<int>(max - min + 1));
+	// If we have trained pattern weights, pick the move that leaves the board looking best for us. The evaluator
+	// only has to look at the segments through each candidate square, so this is cheap even on a 12x12 board
+	if (IsEvaluatorInUse())
+	{
+		float bestValue = 0.0f;
+		for (int i = 0; i < iBoardWidth * iBoardHeight; i++)
+		{
+			if (cBoard[i] != ' ') continue;
+
+			float value = pEvaluator->EvaluateMove(cBoard, iBoardWidth, iBoardHeight, i, piece);
+			if (location == -1 || value > bestValue)
+			{
+				bestValue = value;
+				location = i;
+			}
+		}
+		return location;
+	}
+
+	// Otherwise just pick a random one
+	return PickRandomMove();
+}
+
+bool TicTacToeBoard::IsSearchInUse() const
+{
+	return stEngineSettings.iSearchDepth > 0 || stEngineSettings.iTimeBudgetMs > 0;
+}
+
+bool TicTacToeBoard::IsEvaluatorInUse() const
+{
+	// Weights trained on some other size of board would just be guessing, so after a resize they sit it out until the
+	// board goes back to the size they know
+	return stEngineSettings.bUsePatterns && pEvaluator != NULL && pEvaluator->IsTrainedFor(iBoardWidth, iBoardHeight);
+}
+
+int TicTacToeBoard::PickRandomMove() const
+{
+	assert(iNumMovesMadeSoFar < iBoardWidth * iBoardHeight);
+
+	int location = RandomInt(iBoardWidth * iBoardHeight);
 	while (cBoard[location] != ' ')
 	{
-		location = min + (rand() % static_cast<int>(max - min + 1));
+		location = RandomInt(iBoardWidth * iBoardHeight);
 	}
 	return location;
 }
 
+int TicTacToeBoard::RandomInt(int range) const
+{
+	// xorshift32. Each board has its own generator so that games can be replayed from a seed, even several at once
+	iRandomState ^= iRandomState << 13;
+	iRandomState ^= iRandomState >> 17;
+	iRandomState ^= iRandomState << 5;
+	return (int)(iRandomState % (uint32_t)range);
+}
+
+void TicTacToeBoard::SetRandomSeed(unsigned int seed)
+{
+	// xorshift gets stuck on zero, so make sure we never start there
+	iRandomState = (uint32_t)MixBits(seed) | 1;
+}
+
+void TicTacToeBoard::SetEngineSettings(const EngineSettings& settings)
+{
+	stEngineSettings = settings;
+}
+
+void TicTacToeBoard::MakeMove(int location, const char piece)
+{
+	assert(pSparseBoard == NULL);
+	assert(IsLegalPlayerMove(location));
+
+	RecordMove(location, piece);
+}
+
+// Alpha-beta search, trying moves on the real board and taking them back again. With a time budget it deepens one
+// ply at a time and keeps the answer from the deepest search that finished before the time ran out
+int TicTacToeBoard::SearchBestMove(const char piece, const char opponent, bool* worthCaching)
+{
+	assert(worthCaching != NULL);
+
+	int squaresLeft = iBoardWidth * iBoardHeight - iNumMovesMadeSoFar;
+	int maxDepth = stEngineSettings.iSearchDepth > 0 ? stEngineSettings.iSearchDepth : squaresLeft;
+	if (maxDepth > squaresLeft) maxDepth = squaresLeft;
+
+	bSearchHasDeadline = stEngineSettings.iTimeBudgetMs > 0;
+	tSearchDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(stEngineSettings.iTimeBudgetMs);
+	bSearchAborted = false;
+	iSearchNodes = 0;
+	// The search puts the board back the way it found it, so the status will still be right afterwards
+	int statusNode = iStatusNode;
+
+	int bestLocation = -1;
+	for (int depth = bSearchHasDeadline ? 1 : maxDepth; depth <= maxDepth; depth++)
+	{
+		int location = -1;
+		float value = Negamax(piece, opponent, depth, -2.0f * cSearchWinScore, 2.0f * cSearchWinScore, &location);
+		if (bSearchAborted) break;
+
+		bestLocation = location;
+		// No point looking any deeper once we have found a forced win or loss
+		if (value >= cSearchWinScore || value <= -cSearchWinScore) break;
+	}
+
+	// If the clock stopped us then the answer depends on how busy the machine was, so it mustn't be handed on to other
+	// processes as if it were the answer for these settings. A search that got to the end before the deadline is fine
+	*worthCaching = !bSearchAborted;
+	iStatusNode = statusNode;
+
+	// The clock can run out before even the one move deep search is done
+	if (bestLocation == -1) bestLocation = PickRandomMove();
+	return bestLocation;
+}
+
+float TicTacToeBoard::Negamax(const char piece, const char opponent, int depth, float alpha, float beta, int* bestLocation)
+{
+	int boardSize = iBoardWidth * iBoardHeight;
+	float bestValue = -2.0f * cSearchWinScore;
+
+	for (int location = 0; location < boardSize; location++)
+	{
+		if (cBoard[location] != ' ') continue;
+
+		if (bSearchHasDeadline && ++iSearchNodes % cSearchClockCheckInterval == 0)
+		{
+			if (std::chrono::steady_clock::now() >= tSearchDeadline) bSearchAborted = true;
+		}
+		if (bSearchAborted) return 0.0f;
+
+		SetSquare(location, piece);
+		iNumMovesMadeSoFar++;
+
+		float value;
+		if (DidSomeoneWin(piece)) value = cSearchWinScore + depth;
+		else if (iNumMovesMadeSoFar == boardSize) value = 0.0f;
+		else if (depth <= 1) value = EvaluateLeaf(piece);
+		else value = -Negamax(opponent, piece, depth - 1, -beta, -alpha, NULL);
+
+		iNumMovesMadeSoFar--;
+		SetSquare(location, ' ');
+
+		if (value > bestValue)
+		{
+			bestValue = value;
+			if (bestLocation != NULL) *bestLocation = location;
+		}
+		if (value > alpha) alpha = value;
+		if (alpha >= beta) break;
+	}
+	return bestValue;
+}
+
+float TicTacToeBoard::EvaluateLeaf(const char piece) const
+{
+	// Without the evaluator, all we know about an unfinished game is that nobody has won it yet
+	if (!IsEvaluatorInUse()) return 0.0f;
+	return 2.0f * pEvaluator->EstimateWinChance(cBoard, iBoardWidth, iBoardHeight, piece) - 1.0f;
+}
+
 // OK, so I found a rule that works well for definition of a diagonal win for non square boards. 
 // Basically if you can find a diagonal set of squares starting at any top row location and 
 // proceeding either forward+down or backward+down, then you can call that a win. 
@@ -447,16 +1246,11 @@ bool TicTacToeBoard::HasDiagonalBeenWon(int topRowStartLocation, bool forward, c
 	int numPiecesFound = 0;
 
 	int column = topRowStartLocation;
-	int row = 0;
-	int boardSize = iBoardWidth * iBoardHeight;
-	int rowIncrement = 1;
 
-	if (!forward)
-		rowIncrement = -1;
-
-	for (int i = 0; i < iBoardHeight; i++)
+	// One square per row, moving one column across each time and wrapping around the sides
+	for (int row = 0; row < iBoardHeight; row++)
 	{
-		int location = (row * iBoardWidth + column) % boardSize;
+		int location = row * iBoardWidth + column;
 
 		if (cBoard[location] == piece)
 		{
@@ -470,11 +1264,9 @@ bool TicTacToeBoard::HasDiagonalBeenWon(int topRowStartLocation, bool forward, c
 		}
 		else
 		{
-			column += iBoardWidth;
+			column += iBoardWidth - 1;
 			column %= iBoardWidth;
 		}
-
-
 	}
 	if (numPiecesFound == iBoardHeight) return true;
 	return false;
@@ -511,7 +1303,7 @@ int TicTacToeBoard::CheckSomeoneAboutToWinRow(int row, const char piece) const
 	int blankSquare = -1;
 	for (int x = 0; x < iBoardWidth; x++)
 	{
-		int location = row * iBoardHeight + x;
+		int location = row * iBoardWidth + x;
 		if (cBoard[location] == piece)
 		{
 			numPiecesFound++;
@@ -541,7 +1333,7 @@ int TicTacToeBoard::CheckSomeoneAboutToWinCol(int col, const char piece) const
 			blankSquare = location;
 		}
 	}
-	if (numPiecesFound == iBoardWidth - 1) return blankSquare;
+	if (numPiecesFound == iBoardHeight - 1) return blankSquare;
 	return -1;
 }
 
@@ -551,16 +1343,11 @@ int TicTacToeBoard::CheckSomeoneAboutToWinDiag(int topRowStartLocation, bool for
 	int numPiecesFound = 0;
 	int blankSquare = -1;
 	int column = topRowStartLocation;
-	int row = 0;
-	int boardSize = iBoardWidth * iBoardHeight;
-	int rowIncrement = 1;
 
-	if (!forward)
-		rowIncrement = -1;
-
-	for (int i = 0; i < iBoardHeight; i++)
+	// The same walk as HasDiagonalBeenWon
+	for (int row = 0; row < iBoardHeight; row++)
 	{
-		int location = (row * iBoardWidth + column) % boardSize;
+		int location = row * iBoardWidth + column;
 
 		if (cBoard[location] == piece)
 		{
@@ -579,7 +1366,7 @@ int TicTacToeBoard::CheckSomeoneAboutToWinDiag(int topRowStartLocation, bool for
 		}
 		else
 		{
-			column += iBoardWidth;
+			column += iBoardWidth - 1;
 			column %= iBoardWidth;
 		}
 	}
@@ -587,6 +1374,103 @@ int TicTacToeBoard::CheckSomeoneAboutToWinDiag(int topRowStartLocation, bool for
 	return -1;
 }
 
+void TicTacToeBoard::SetEvaluator(const PatternEvaluator* evaluator)
+{
+	pEvaluator = evaluator;
+}
+
+// Temporal difference learning on afterstates. After each move, the position the opponent left us with gets nudged
+// towards the opposite of how good things now look for the side that just moved. At the end of the game both of the
+// last two positions get nudged towards the actual result instead
+void TicTacToeBoard::TrainEvaluatorBySelfPlay(PatternEvaluator* evaluator, int numGames, unsigned int seed)
+{
+	assert(evaluator != NULL);
+	assert(pSparseBoard == NULL);
+
+	const float learningRate = 0.01f;
+	const float explorationRate = 0.1f;
+
+	int boardSize = iBoardWidth * iBoardHeight;
+	char* previousBoard = new char[boardSize];
+	int numWins[2] = { 0, 0 };
+	SetRandomSeed(seed);
+
+	for (int game = 0; game < numGames; game++)
+	{
+		ResetBoard();
+		char mover = cPlayerPiece;
+		char opponent = cComputerPiece;
+
+		while (true)
+		{
+			// Mostly play the move the evaluator likes best, but explore now and then so that it gets to see more
+			// than one line of play. Exploratory moves don't teach us anything about the position before them
+			int location = -1;
+			bool exploring = RandomInt(1000) < (int)(explorationRate * 1000);
+			if (exploring)
+			{
+				location = PickRandomMove();
+			}
+			else
+			{
+				float bestValue = 0.0f;
+				for (int i = 0; i < boardSize; i++)
+				{
+					if (cBoard[i] != ' ') continue;
+
+					float value = evaluator->EvaluateMove(cBoard, iBoardWidth, iBoardHeight, i, mover);
+					if (location == -1 || value > bestValue)
+					{
+						bestValue = value;
+						location = i;
+					}
+				}
+			}
+
+			memcpy(previousBoard, cBoard, boardSize);
+			bool hasPrevious = iNumMovesMadeSoFar > 0;
+			RecordMove(location, mover);
+
+			if (DidSomeoneWin(mover))
+			{
+				evaluator->Train(cBoard, iBoardWidth, iBoardHeight, mover, 1.0f, learningRate);
+				if (hasPrevious) evaluator->Train(previousBoard, iBoardWidth, iBoardHeight, opponent, 0.0f, learningRate);
+				numWins[mover == cPlayerPiece ? 0 : 1]++;
+				break;
+			}
+			if (IsGameADraw())
+			{
+				evaluator->Train(cBoard, iBoardWidth, iBoardHeight, mover, 0.5f, learningRate);
+				if (hasPrevious) evaluator->Train(previousBoard, iBoardWidth, iBoardHeight, opponent, 0.5f, learningRate);
+				break;
+			}
+			if (hasPrevious && !exploring)
+			{
+				float target = 1.0f - evaluator->EstimateWinChance(cBoard, iBoardWidth, iBoardHeight, mover);
+				evaluator->Train(previousBoard, iBoardWidth, iBoardHeight, opponent, target, learningRate);
+			}
+
+			char swap = mover;
+			mover = opponent;
+			opponent = swap;
+		}
+
+		if ((game + 1) % 1000 == 0 || game + 1 == numGames)
+		{
+			std::cout << "Trained " << game + 1 << " games. First player won " << numWins[0] << ", second player won " << numWins[1] << "\n";
+			numWins[0] = numWins[1] = 0;
+		}
+	}
+
+	delete[] previousBoard;
+	ResetBoard();
+}
+
+void TicTacToeBoard::SetAnalysisCache(AnalysisCache* cache)
+{
+	pAnalysisCache = cache;
+}
+
 void TicTacToeBoard::PrintHelp()
 {
 	std::cout << "You will play against the computer. Your will play cPlayerPiece and the computer will play cComputerPiece\n";
@@ -599,6 +1483,12 @@ void TicTacToeBoard::PrintHelp()
 	std::cout << "    restart: restarts the game\n";
 	std::cout << "    (0..BoardWidth-1),(0..BoardHeight-1): chooses a square on the board on which to place your piece\n";
 	std::cout << "    resize: prompts for a new set of board dimensions (min 3x3)\n";
+	std::cout << "    ansi: toggles keeping the board at the top of the screen and only redrawing the squares that change\n";
+	std::cout << "    sparse: prompts for the dimensions and win length of a large (or unbounded) K in a row board\n";
 	std::cout << "    undo: rewinds the game one step (note that if you choose to undo one of your moves, the computers last move will also be undone)\n";
+	std::cout << "    redo: replays the moves you undid, one step at a time. Making a different move instead starts a new line\n";
+	std::cout << "    goto: prompts for a move number and jumps straight to that point in the current line\n";
+	std::cout << "    lines: lists the moves that have been tried from this point, each of which starts a different line\n";
+	std::cout << "    switch: prompts for one of those lines and redoes into it, so you can go back to a line you abandoned\n";
 	std::cout << "    quit: exits the game\n\n\n";
 }
@@ -1,6 +1,12 @@
 #pragma once
 #include <iostream>
 #include <cstdint>
+#include <string>
+#include <chrono>
+#include <vector>
+#include "SparseBoard.h"
+#include "PatternEvaluator.h"
+#include "AnalysisCache.h"
 
 // We will need a few things as part of the core architecture/functionality
 // 1) A data structure to represent the state of the board
@@ -14,6 +20,19 @@
 // 1) An undo system that lets the user rewind/forward the game arbitrarily
 // 2) Support a generalized m,n,k variation of the game 
 
+// How the computer goes about choosing a move on the dense board. The defaults are the original fixed rules, plus the
+// pattern evaluator if one has been loaded
+struct EngineSettings
+{
+	// Use the pattern evaluator, if it has weights, to choose between moves and to score the ends of searches
+	bool bUsePatterns = true;
+	// Look this many moves ahead with an alpha-beta search instead of using the fixed rules. 0 means no depth limit
+	// when there is a time budget, and no search at all when there isn't
+	int iSearchDepth = 0;
+	// Keep deepening the search until this many milliseconds have gone by. 0 means no time limit
+	int iTimeBudgetMs = 0;
+};
+
 // Normally I would separate things out into a number of header and implementation files, but since this is so small
 // and because I want to make it easy for the reviewers, I am just going to implement the whole shebang right here
 
@@ -34,6 +53,17 @@ public:
 	void Quit();
 	bool IsTimeToQuit() const;
 	void Undo();
+	// Returns false if there is nothing to redo
+	bool Redo();
+	// Jumps to any ply (0 being the empty board) of the current line, including the part of it that has been undone.
+	// Returns false if the line doesn't go that far
+	bool SeekToPly(int ply);
+	int GetNumPliesInLine() const;
+	// The moves that have been tried from the current position, each of which starts a different line
+	void PrintVariations() const;
+	int GetNumVariations() const;
+	// Makes the current line follow the variation numbered (from 1) as PrintVariations lists them. The board stays put
+	bool SwitchToVariation(int variation);
 	bool DidSomeoneWin(const char piece) const;
 	bool IsGameADraw() const;
 	void ResetBoard();
@@ -43,6 +73,25 @@ public:
 	// Otherwise it would be a const member
 	static void PrintHelp();
 
+	// The evaluator is not owned by the board. Passing NULL (or an evaluator without weights) goes back to the fixed rules,
+	// and so does any board size other than the one the weights were trained on
+	void SetEvaluator(const PatternEvaluator* evaluator);
+	// Plays numGames games of the computer against itself on this board, using temporal difference learning to train
+	// the evaluator as it goes. This takes over the board, so it should be done instead of playing, not during
+	void TrainEvaluatorBySelfPlay(PatternEvaluator* evaluator, int numGames, unsigned int seed);
+	// The cache is not owned by the board either. Passing NULL turns caching off
+	void SetAnalysisCache(AnalysisCache* cache);
+	// ANSI mode keeps the board at the top of the terminal and only rewrites the squares that changed between frames
+	void SetAnsiRendering(bool enabled);
+
+	// These let the computer play either side without anyone at the keyboard (see Arena). None of them print anything
+	void SetEngineSettings(const EngineSettings& settings);
+	void SetRandomSeed(unsigned int seed);
+	// Looks the position up in the analysis cache (if there is one) before doing the real work in AnalyseBestMove
+	int CalculateBestMove(const char piece);
+	int PickRandomMove() const;
+	void MakeMove(int location, const char piece);
+
 
 	~TicTacToeBoard();
 
@@ -56,12 +105,37 @@ private:
 
 	void PlacePlayerPiece(int location);
 	void PlaceComputerPiece(int location);
+	// Every change to a square of the dense board goes through here so that the board hash stays up to date
+	void SetSquare(int location, const char piece);
+	// Plays a move and adds it to the move tree
+	void RecordMove(int location, const char piece);
+	// Makes the current line run through node and then on down the moves that were last played from there
+	void FollowLineThrough(int node);
+	void TakeSnapshot(int node);
+
+	// The sparse (large or unbounded m,n,k) board mode. Switching into it frees the dense board memory
+	void SwitchToSparseBoard(int width, int height, int winLength);
+	void PlaceSparsePlayerPiece(int x, int y);
 
 	int WhichRow(int location) const;
 	int WhichColumn(int location) const;
 
-	int CalculateBestComputerMove() const;
-
+	// worthCaching only gets set for a search result that doesn't depend on the clock. Nothing else is worth sharing
+	int AnalyseBestMove(const char piece, bool* worthCaching);
+	// Folds in everything other than the position that changes which move gets picked
+	uint64_t EngineSettingsKey(const char piece) const;
+	bool IsEvaluatorInUse() const;
+	bool IsSearchInUse() const;
+	int RandomInt(int range) const;
+
+	// worthCaching gets set to false if the time ran out before the search was finished
+	int SearchBestMove(const char piece, const char opponent, bool* worthCaching);
+	// Returns the score of the position for piece, which is the side to move
+	float Negamax(const char piece, const char opponent, int depth, float alpha, float beta, int* bestLocation);
+	float EvaluateLeaf(const char piece) const;
+
+	// Looks at every row, column and diagonal. DidSomeoneWin only needs this when the board isn't at a move tree node
+	bool ScanForWin(const char piece) const;
 	bool HasDiagonalBeenWon(int topRowStartLocation, bool forward, const char piece) const;
 	bool HasRowBeenWon(int row, const char piece) const;
 	bool HasColumnBeenWon(int row, const char piece) const;
@@ -76,9 +150,12 @@ private:
 	void CheckAndAdjustSizes();
 	void AllocateBoardMemory();
 	bool IsLegalPlayerMove(int moveLocation) const;
-	void PrintRowOfDashes() const;
+	void AppendFullFrame(int firstColumn, int lastColumn, int firstRow, int lastRow) const;
+	void AppendChangedSquares(int firstColumn, int lastColumn, int lastRow) const;
+	void AppendRowOfDashes(int rowLabelWidth, int numColumns, int squareWidth) const;
 	bool IsInputAMoveLocation(const std::string input) const;
 	bool IsInputAValidSize(const std::string input) const;
+	bool IsInputAValidSparseSize(const std::string input) const;
 	bool GetInputMoveLocation(const std::string input, int* x, int* y) const;
 
 
@@ -92,12 +169,76 @@ private:
 	// A value of ' ' indicates that the square is currently empty
 	char* cBoard = NULL;
 
-	// This is the history of the moves made by the player
+	// This is the number of moves made so far in the current line, which is also the current ply
 	int iNumMovesMadeSoFar;
-	int* iMoves;
+
+	// The history of the game is a tree of moves, so that the lines that get undone are still there to be redone or
+	// switched back to. Node 0 is the empty board
+	struct MoveNode
+	{
+		int location;
+		char piece;
+		int ply;
+		int parent;
+		int firstChild, nextSibling;
+		// The child that was last played from here, which is where redo goes
+		int redoChild;
+		// Index into vSnapshots, for the nodes whose ply is a multiple of cSnapshotInterval. Otherwise unused
+		int snapshot;
+		// The status of the game in this position, worked out once when the node is made, so that going back to it
+		// doesn't mean checking the whole board for wins again
+		bool playerHasLine, computerHasLine;
+	};
+	struct BoardSnapshot
+	{
+		uint64_t hash;
+		// Where the copy of the board starts in vSnapshotSquares
+		size_t squaresOffset;
+	};
+	std::vector<MoveNode> vMoveTree;
+	std::vector<BoardSnapshot> vSnapshots;
+	std::vector<char> vSnapshotSquares;
+	// The nodes of the line we are on, by ply. This carries on past the current ply after an undo
+	std::vector<int> vCurrentLine;
+	// The node whose status matches the board, or -1 if the board has been changed outside of the tree (by a search)
+	int iStatusNode = -1;
+
+	// Zobrist hash of the dense board, updated incrementally as pieces come and go
+	uint64_t iBoardHash;
 
 	bool bTimeToQuit = false;
 
+	// When this is set we are in sparse board mode and cBoard is not allocated
+	SparseBoard* pSparseBoard = NULL;
+
+	// Used to choose between moves once the fixed "about to win" rules have nothing to say
+	const PatternEvaluator* pEvaluator = NULL;
+
+	// Shared with other game processes, so anything we work out can be reused by them and by later runs
+	AnalysisCache* pAnalysisCache = NULL;
+
+	EngineSettings stEngineSettings;
+	// The random moves come from here rather than rand(), so that each board can be seeded on its own
+	mutable uint32_t iRandomState = 2463534242u;
+
+	// Search state
+	std::chrono::steady_clock::time_point tSearchDeadline;
+	bool bSearchHasDeadline = false;
+	bool bSearchAborted = false;
+	int iSearchNodes = 0;
+
+	// Rendering. PrintBoard is const, but these are just scratch space and a memory of what is already on screen
+	mutable std::string sFrameBuffer;
+	mutable std::string sFrameTitle;
+	mutable std::string sFrameSquares;
+	mutable std::string sLastFrameTitle;
+	mutable std::string sLastFrameSquares;
+	mutable int iLastFrameFirstColumn = 0;
+	mutable int iLastFrameFirstRow = 0;
+	mutable int iLastFrameNumColumns = 0;
+	mutable bool bHaveLastFrame = false;
+	bool bAnsiRendering = false;
+
 
 };
 